@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+
+
+#include "Config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ResultSet.h"
+#include "Arrow.h"
+
+
+/**
+ * Implementation of the Arrow C Data Interface export
+ *
+ * @file
+ */
+
+
+/* ----------------------------------------------------------- Definitions */
+
+
+/* A column array under construction, owned by its child ArrowArray */
+typedef struct Column_S {
+        int type;
+        int64_t length;
+        int64_t nulls;
+        int64_t capacity;
+        int64_t size;
+        uint8_t *validity;
+        void *values;
+        char *data;
+        const void *buffers[3];
+} *Column_T;
+
+
+/* ------------------------------------------------------- Private methods */
+
+
+static void releaseSchema(struct ArrowSchema *schema) {
+        for (int i = 0; i < schema->n_children; i++) {
+                struct ArrowSchema *child = schema->children[i];
+                if (child->release)
+                        child->release(child);
+                FREE(child);
+        }
+        FREE(schema->children);
+        schema->release = NULL;
+}
+
+
+static void releaseField(struct ArrowSchema *field) {
+        char *name = (char*)field->name;
+        FREE(name);
+        field->release = NULL;
+}
+
+
+static void freeColumn(Column_T *C) {
+        FREE((*C)->validity);
+        FREE((*C)->values);
+        FREE((*C)->data);
+        FREE(*C);
+}
+
+
+static void releaseArray(struct ArrowArray *array) {
+        for (int i = 0; i < array->n_children; i++) {
+                struct ArrowArray *child = array->children[i];
+                if (child->release)
+                        child->release(child);
+                FREE(child);
+        }
+        FREE(array->children);
+        FREE(array->buffers);
+        array->release = NULL;
+}
+
+
+static void releaseColumn(struct ArrowArray *array) {
+        Column_T C = array->private_data;
+        freeColumn(&C);
+        array->release = NULL;
+}
+
+
+static inline const char *format(int type) {
+        switch (type) {
+                case ColumnType_Integer: return "l";
+                case ColumnType_Real: return "g";
+                case ColumnType_Blob: return "z";
+                default: return "u";
+        }
+}
+
+
+static inline int isFixed(Column_T C) {
+        return (C->type == ColumnType_Integer || C->type == ColumnType_Real);
+}
+
+
+/* Grow the column so it can hold one more row. Values are 64 bits for fixed size types
+ and 32 bits offsets into data for variable size types */
+static void ensureCapacity(Column_T C) {
+        if (C->length == C->capacity) {
+                long valuesSize;
+                if (C->capacity == 0) {
+                        C->capacity = 1024;
+                        valuesSize = isFixed(C) ? C->capacity * sizeof(int64_t) : (C->capacity + 1) * sizeof(int32_t);
+                        C->validity = CALLOC(1, C->capacity / 8);
+                        C->values = CALLOC(1, valuesSize);
+                } else {
+                        C->capacity *= 2;
+                        valuesSize = isFixed(C) ? C->capacity * sizeof(int64_t) : (C->capacity + 1) * sizeof(int32_t);
+                        RESIZE(C->validity, C->capacity / 8);
+                        memset(C->validity + C->length / 8, 0, (C->capacity - C->length) / 8);
+                        RESIZE(C->values, valuesSize);
+                }
+        }
+}
+
+
+/* Widen a fixed size column when a value in a later row has another type. A column
+ without a declared type in SQLite has the type of the value in the first row. An
+ integer column widens to real, any other mix of types to utf8 with the values
+ already added written as text */
+static void widen(Column_T C, int type) {
+        if (type == C->type || (C->type == ColumnType_Real && type == ColumnType_Integer))
+                return;
+        if (C->type == ColumnType_Integer && type == ColumnType_Real) {
+                for (int64_t i = 0; i < C->length; i++)
+                        ((double*)C->values)[i] = (double)((int64_t*)C->values)[i];
+                C->type = ColumnType_Real;
+                return;
+        }
+        int32_t *offsets = CALLOC(C->capacity + 1, sizeof(int32_t));
+        C->size = 4096;
+        C->data = ALLOC(C->size);
+        for (int64_t i = 0; i < C->length; i++) {
+                int length = 0;
+                if (C->validity[i / 8] & (1 << (i % 8))) {
+                        // Room for the longest integer or real as text
+                        if (offsets[i] + 32 > C->size) {
+                                C->size *= 2;
+                                RESIZE(C->data, C->size);
+                        }
+                        if (C->type == ColumnType_Integer)
+                                length = snprintf(C->data + offsets[i], 32, "%lld", (long long)((int64_t*)C->values)[i]);
+                        else
+                                length = snprintf(C->data + offsets[i], 32, "%.15g", ((double*)C->values)[i]);
+                }
+                offsets[i + 1] = offsets[i] + length;
+        }
+        FREE(C->values);
+        C->values = offsets;
+        C->type = ColumnType_Text;
+}
+
+
+static inline void append(Column_T C, ResultSet_T R, int columnIndex) {
+        int isNull = ResultSet_isnull(R, columnIndex);
+        if (! isNull && isFixed(C))
+                widen(C, ResultSet_getColumnType(R, columnIndex));
+        ensureCapacity(C);
+        int64_t row = C->length++;
+        int32_t *offsets = C->values;
+        if (isNull) {
+                C->nulls++;
+                if (isFixed(C))
+                        ((int64_t*)C->values)[row] = 0;
+                else
+                        offsets[row + 1] = offsets[row];
+                return;
+        }
+        C->validity[row / 8] |= (uint8_t)(1 << (row % 8));
+        if (C->type == ColumnType_Integer) {
+                ((int64_t*)C->values)[row] = ResultSet_getLLong(R, columnIndex);
+        } else if (C->type == ColumnType_Real) {
+                ((double*)C->values)[row] = ResultSet_getDouble(R, columnIndex);
+        } else {
+                int length = 0;
+                const void *value = (C->type == ColumnType_Blob) ? ResultSet_getBlob(R, columnIndex, &length) : ResultSet_getString(R, columnIndex);
+                if (C->type != ColumnType_Blob)
+                        length = (int)ResultSet_getColumnSize(R, columnIndex);
+                if ((int64_t)offsets[row] + length > INT32_MAX)
+                        THROW(SQLException, "Arrow batch is too large, use a smaller number of rows");
+                if (offsets[row] + length > C->size) {
+                        while (offsets[row] + length > C->size)
+                                C->size *= 2;
+                        RESIZE(C->data, C->size);
+                }
+                memcpy(C->data + offsets[row], value, length);
+                offsets[row + 1] = offsets[row] + length;
+        }
+}
+
+
+static void exportSchema(ResultSet_T R, Column_T *columns, int count, struct ArrowSchema *schema) {
+        *schema = (struct ArrowSchema){.format = "+s", .name = "", .n_children = count, .release = releaseSchema};
+        schema->children = CALLOC(count ? count : 1, sizeof *schema->children);
+        for (int i = 0; i < count; i++) {
+                const char *name = ResultSet_getColumnName(R, i + 1);
+                NEW(schema->children[i]);
+                *schema->children[i] = (struct ArrowSchema){
+                        .format = format(columns[i]->type),
+                        .name = Str_dup(name ? name : ""),
+                        .flags = ARROW_FLAG_NULLABLE,
+                        .release = releaseField
+                };
+        }
+}
+
+
+static void exportArray(Column_T *columns, int count, int64_t rows, struct ArrowArray *array) {
+        *array = (struct ArrowArray){.length = rows, .n_buffers = 1, .n_children = count, .release = releaseArray};
+        array->buffers = CALLOC(1, sizeof *array->buffers);
+        array->children = CALLOC(count ? count : 1, sizeof *array->children);
+        for (int i = 0; i < count; i++) {
+                Column_T C = columns[i];
+                C->buffers[0] = C->nulls ? C->validity : NULL;
+                C->buffers[1] = C->values;
+                C->buffers[2] = C->data;
+                NEW(array->children[i]);
+                *array->children[i] = (struct ArrowArray){
+                        .length = C->length,
+                        .null_count = C->nulls,
+                        .n_buffers = isFixed(C) ? 2 : 3,
+                        .buffers = C->buffers,
+                        .release = releaseColumn,
+                        .private_data = C
+                };
+        }
+}
+
+
+/* -------------------------------------------------------- Public methods */
+
+
+int Arrow_exportResultSet(ResultSet_T R, int maxRows, struct ArrowSchema *schema, struct ArrowArray *array) {
+        assert(R);
+        assert(maxRows > 0);
+        assert(schema);
+        assert(array);
+        schema->release = NULL;
+        array->release = NULL;
+        if (! ResultSet_next(R))
+                return 0;
+        int count = ResultSet_getColumnCount(R);
+        Column_T *columns = CALLOC(count ? count : 1, sizeof *columns);
+        volatile int rows = 0;
+        TRY
+        {
+                for (int i = 0; i < count; i++) {
+                        NEW(columns[i]);
+                        columns[i]->type = ResultSet_getColumnType(R, i + 1);
+                        ensureCapacity(columns[i]);
+                        if (! isFixed(columns[i])) {
+                                columns[i]->size = 4096;
+                                columns[i]->data = ALLOC(columns[i]->size);
+                        }
+                }
+                do {
+                        for (int i = 0; i < count; i++)
+                                append(columns[i], R, i + 1);
+                        rows++;
+                } while (rows < maxRows && ResultSet_next(R));
+        }
+        ELSE
+        {
+                for (int i = 0; i < count; i++)
+                        if (columns[i])
+                                freeColumn(&columns[i]);
+                FREE(columns);
+                RETHROW;
+        }
+        END_TRY;
+        exportSchema(R, columns, count, schema);
+        exportArray(columns, count, rows, array);
+        FREE(columns);
+        return rows;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+
+
+#ifndef ARROW_INCLUDED
+#define ARROW_INCLUDED
+#include <stdint.h>
+
+
+/**
+ * <b>Arrow</b> exports rows from a ResultSet as a record batch in the 
+ * <a href="https://arrow.apache.org/docs/format/CDataInterface.html">
+ * Arrow C Data Interface</a> format. The C Data Interface is a pair of 
+ * plain C structs, ArrowSchema and ArrowArray, which can be handed to a
+ * columnar engine that supports Arrow without a copy and without linking
+ * with an Arrow library.
+ *
+ * The batch is a struct array with one child array per column in the 
+ * ResultSet. Integer columns are exported as int64, floating point 
+ * columns as float64, binary columns as binary and all other columns as
+ * utf8. Values are read with the numeric get-methods in the ResultSet, 
+ * so numeric values are not converted to text where the database 
+ * supports this, see ResultSet_getLLong(). All columns are nullable.
+ * The type of a column is read from the first row. If a later row in the
+ * batch has a value of another type, which SQLite allows in a column 
+ * without a declared type, the column is widened to float64 for a mix of 
+ * integers and reals, and otherwise to utf8.
+ *
+ * <h3>Example:</h3>
+ * <pre>
+ * struct ArrowSchema schema;
+ * struct ArrowArray array;
+ * ResultSet_T r = Connection_executeQuery(con, "SELECT id, name, salary FROM employees");
+ * while (Arrow_exportResultSet(r, 65536, &schema, &array)) {
+ *         // Hand over schema and array, the consumer calls release when done
+ *         consume(&schema, &array);
+ * }
+ * </pre>
+ *
+ * @see ResultSet.h
+ * @file
+ */
+
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+        const char *format;
+        const char *name;
+        const char *metadata;
+        int64_t flags;
+        int64_t n_children;
+        struct ArrowSchema **children;
+        struct ArrowSchema *dictionary;
+        void (*release)(struct ArrowSchema *);
+        void *private_data;
+};
+
+struct ArrowArray {
+        int64_t length;
+        int64_t null_count;
+        int64_t offset;
+        int64_t n_buffers;
+        int64_t n_children;
+        const void **buffers;
+        struct ArrowArray **children;
+        struct ArrowArray *dictionary;
+        void (*release)(struct ArrowArray *);
+        void *private_data;
+};
+
+#endif
+
+
+/**
+ * Export up to <code>maxRows</code> rows from the ResultSet as an Arrow
+ * record batch. The ResultSet cursor is moved past the exported rows. 
+ * On return, <code>schema</code> and <code>array</code> are owned by 
+ * the caller and must be released by calling their release callback,
+ * per the C Data Interface. The exported data does not reference the 
+ * ResultSet and is valid after the ResultSet is closed. If there are 
+ * no more rows, nothing is exported and the release callbacks are set
+ * to NULL.
+ * @param R A ResultSet object
+ * @param maxRows The maximum number of rows in the batch, must be > 0
+ * @param schema The schema of the batch is stored in schema
+ * @param array The batch is stored in array
+ * @return The number of rows exported; 0 if there are no more rows
+ * @exception SQLException if a database access error occurs or if a 
+ * value cannot be converted to the column's type
+ * @see ResultSet.h
+ * @see SQLException.h
+ */
+int Arrow_exportResultSet(ResultSet_T R, int maxRows, struct ArrowSchema *schema, struct ArrowArray *array);
+
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+
+
+#include "Config.h"
+
+#include <stdio.h>
+
+#include "Blob.h"
+
+
+/**
+ * Implementation of the Blob interface 
+ *
+ * @file
+ */
+
+
+/* ----------------------------------------------------------- Definitions */
+
+
+#define T Blob_T
+struct Blob_S {
+        Bop_T op;
+        int isClosed;
+        BlobDelegate_T D;
+};
+
+
+/* ------------------------------------------------------- Private methods */
+
+
+static inline void testOpen(T B) {
+        if (B->isClosed)
+                THROW(SQLException, "Blob is closed");
+}
+
+
+/* ----------------------------------------------------- Protected methods */
+
+
+#ifdef PACKAGE_PROTECTED
+#pragma GCC visibility push(hidden)
+#endif
+
+T Blob_new(BlobDelegate_T D, Bop_T op) {
+	T B;
+	assert(D);
+	assert(op);
+	NEW(B);
+	B->D = D;
+	B->op = op;
+	return B;
+}
+
+
+void Blob_free(T *B) {
+	assert(B && *B);
+        (*B)->op->free(&(*B)->D);
+	FREE(*B);
+}
+
+#ifdef PACKAGE_PROTECTED
+#pragma GCC visibility pop
+#endif
+
+
+/* ------------------------------------------------------------ Properties */
+
+
+int Blob_getSize(T B) {
+        assert(B);
+        testOpen(B);
+        return B->op->getSize(B->D);
+}
+
+
+/* -------------------------------------------------------- Public methods */
+
+
+int Blob_read(T B, void *buffer, int size, int offset) {
+        assert(B);
+        assert(buffer);
+        assert(size >= 0);
+        testOpen(B);
+        if (offset < 0)
+                THROW(SQLException, "Blob offset is out of range");
+        return B->op->read(B->D, buffer, size, offset);
+}
+
+
+void Blob_write(T B, const void *buffer, int size, int offset) {
+        assert(B);
+        assert(buffer);
+        assert(size >= 0);
+        testOpen(B);
+        if (offset < 0)
+                THROW(SQLException, "Blob offset is out of range");
+        B->op->write(B->D, buffer, size, offset);
+}
+
+
+void Blob_reopen(T B, long long int rowid) {
+        assert(B);
+        testOpen(B);
+        B->op->reopen(B->D, rowid);
+}
+
+
+void Blob_close(T B) {
+        assert(B);
+        if (! B->isClosed) {
+                B->op->close(B->D);
+                B->isClosed = true;
+        }
+}
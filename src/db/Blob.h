@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+
+
+#ifndef BLOB_INCLUDED
+#define BLOB_INCLUDED
+//<< Protected methods
+#include "BlobDelegate.h"
+//>> End Protected methods
+
+
+/**
+ * A <b>Blob</b> is a handle to a single binary value in the database which
+ * can be read and written incrementally at an offset. Large values can be
+ * streamed in chunks of a fixed size instead of being loaded into memory 
+ * as a whole with ResultSet_getBlob() or PreparedStatement_setBlob(). A Blob
+ * is created by calling Connection_openBlob() and is currently only 
+ * supported by SQLite.
+ *
+ * A Blob is opened on an existing value and cannot change the size of the 
+ * value. To write a new value, first reserve space for it using the SQLite 
+ * function <code>zeroblob(N)</code> and then write the content with 
+ * Blob_write(). 
+ *
+ * <h3>Example:</h3>
+ * Write a file to the database and read it back in chunks:
+ * <pre>
+ * Connection_execute(con, "INSERT INTO attachment(data) VALUES(zeroblob(%d))", file_size);
+ * Blob_T b = Connection_openBlob(con, "attachment", "data", Connection_lastRowId(con), true);
+ * for (int offset = 0, n; (n = fread(chunk, 1, sizeof(chunk), file)) > 0; offset += n)
+ *        Blob_write(b, chunk, n, offset);
+ * Blob_close(b);
+ * ..
+ * b = Connection_openBlob(con, "attachment", "data", id, false);
+ * for (int offset = 0, n; (n = Blob_read(b, chunk, sizeof(chunk), offset)) > 0; offset += n)
+ *        fwrite(chunk, 1, n, stdout);
+ * </pre>
+ *
+ * An open Blob keeps the statement which opened it active, so a Blob should 
+ * be closed with Blob_close() as soon as it is no longer needed. To stream 
+ * the same column in many rows, move the Blob to a new row with 
+ * Blob_reopen(), which is faster than opening a new Blob. A Blob "lives" 
+ * until the Connection is returned to the Connection Pool and is closed then
+ * if it was not closed before. Open Blobs are also closed when a transaction
+ * is committed or rolled back. 
+ * <i>A Blob is reentrant, but not thread-safe and should only be used by one thread (at the time).</i>
+ *
+ * @see Connection.h ResultSet.h PreparedStatement.h SQLException.h
+ * @file
+ */
+
+
+#define T Blob_T
+typedef struct Blob_S *T;
+
+//<< Protected methods
+
+/**
+ * Create a new Blob.
+ * @param D the delegate used by this Blob
+ * @param op delegate operations
+ * @return A new Blob object
+ */
+T Blob_new(BlobDelegate_T D, Bop_T op);
+
+
+/**
+ * Destroy a Blob and release allocated resources.
+ * @param B A Blob object reference
+ */
+void Blob_free(T *B);
+
+//>> End Protected methods
+
+/** @name Properties */
+//@{
+
+/**
+ * Returns the size of the Blob value in bytes
+ * @param B A Blob object
+ * @return The size of the value in bytes
+ * @exception SQLException if the Blob is closed
+ * @see SQLException.h
+ */
+int Blob_getSize(T B);
+
+//@}
+
+/**
+ * Reads up to <code>size</code> bytes from the Blob value starting at 
+ * <code>offset</code> into <code>buffer</code>
+ * @param B A Blob object
+ * @param buffer The buffer to read into
+ * @param size The size of buffer
+ * @param offset The offset in the Blob value to read from
+ * @return The number of bytes read, which is less than size if the end
+ * of the value was reached and 0 if offset is at or past the end
+ * @exception SQLException if a database error occurs or if the Blob is closed
+ * @see SQLException.h
+ */
+int Blob_read(T B, void *buffer, int size, int offset);
+
+
+/**
+ * Writes <code>size</code> bytes from <code>buffer</code> to the Blob value 
+ * starting at <code>offset</code>. The Blob must be opened for writing and 
+ * offset + size must not exceed the size of the value.
+ * @param B A Blob object
+ * @param buffer The bytes to write
+ * @param size The number of bytes to write
+ * @param offset The offset in the Blob value to write to
+ * @exception SQLException if a database error occurs, if the Blob was 
+ * opened read-only, if the write goes past the end of the value or if the 
+ * Blob is closed
+ * @see SQLException.h
+ */
+void Blob_write(T B, const void *buffer, int size, int offset);
+
+
+/**
+ * Move the Blob to the same column in another row of the same table
+ * @param B A Blob object
+ * @param rowid The rowid of the row to move to
+ * @exception SQLException if a database error occurs, for instance if the 
+ * row does not exist, or if the Blob is closed
+ * @see SQLException.h
+ */
+void Blob_reopen(T B, long long int rowid);
+
+
+/**
+ * Close the Blob and release its database resources. Any further use of 
+ * the Blob, except calling this method again, throws an SQLException.
+ * @param B A Blob object
+ */
+void Blob_close(T B);
+
+
+#undef T
+#endif
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+
+
+#ifndef BLOBDELEGATE_INCLUDED
+#define BLOBDELEGATE_INCLUDED
+
+
+/**
+ * This interface defines the <b>contract</b> for the concrete database 
+ * implementation used for delegation in the Blob class.
+ *
+ * @file
+ */ 
+
+#define T BlobDelegate_T
+typedef struct T *T;
+
+typedef struct Bop_T {
+        const char *name;
+        void (*free)(T *B);
+        int (*getSize)(T B);
+        int (*read)(T B, void *buffer, int size, int offset);
+        void (*write)(T B, const void *buffer, int size, int offset);
+        void (*reopen)(T B, long long int rowid);
+        void (*close)(T B);
+} *Bop_T;
+
+#undef T
+#endif
@@ -26,13 +26,16 @@
 #include "Config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <stdarg.h>
 
 #include "URL.h"
 #include "Vector.h"
+#include "StringBuffer.h"
 #include "system/Time.h"
 #include "ResultSet.h"
 #include "PreparedStatement.h"
+#include "Blob.h"
 #include "Connection.h"
 #include "ConnectionPool.h"
 #include "ConnectionDelegate.h"
@@ -91,6 +94,7 @@ struct Connection_S {
 	int timeout;
 	int isAvailable;
         Vector_T prepared;
+        Vector_T blobs;
 	int isInTransaction;
         time_t lastAccessedTime;
         ResultSet_T resultSet;
@@ -121,6 +125,21 @@ static int setDelegate(T C, char **error) {
 }
 
 
+static void freeBlobs(T C) {
+        while (! Vector_isEmpty(C->blobs)) {
+		Blob_T b = Vector_pop(C->blobs);
+		Blob_free(&b);
+	}
+}
+
+
+/* An open Blob holds the transaction it was opened in, close Blobs before the transaction ends */
+static void closeBlobs(T C) {
+        for (int i = 0; i < Vector_size(C->blobs); i++)
+                Blob_close(Vector_get(C->blobs, i));
+}
+
+
 static void freePrepared(T C) {
         while (! Vector_isEmpty(C->prepared)) {
 		PreparedStatement_T ps = Vector_pop(C->prepared);
@@ -129,6 +148,107 @@ static void freePrepared(T C) {
 }
 
 
+/* Clear the Connection except for its Blobs, which a caller may still hold */
+static void clear(T C) {
+        if (C->resultSet)
+                ResultSet_free(&C->resultSet);
+        if (C->maxRows)
+                Connection_setMaxRows(C, 0);
+        if (C->timeout != SQL_DEFAULT_TIMEOUT)
+                Connection_setQueryTimeout(C, SQL_DEFAULT_TIMEOUT);
+        freePrepared(C);
+}
+
+
+static void addName(int parameterIndex, const char *name, int length, void *ap) {
+        Vector_push(ap, Str_ndup(name, length));
+}
+
+
+/* SQLite binds :name natively and a repeated name is one parameter, so only the
+ first use of a name has a position. A ? is a position without a name */
+static void addNativeName(const char *name, int length, void *ap) {
+        Vector_T names = ap;
+        for (int i = 0; name && i < Vector_size(names); i++) {
+                const char *n = Vector_get(names, i);
+                if (strncmp(n, name, length) == 0 && n[length] == 0)
+                        return;
+        }
+        Vector_push(names, Str_ndup(name ? name : "", length));
+}
+
+
+static PreparedStatement_T prepareStatement(T C, const char *sql, ...) {
+        va_list ap;
+        va_start(ap, sql);
+        PreparedStatement_T p = C->op->prepareStatement(C->D, sql, ap);
+        va_end(ap);
+        return p;
+}
+
+
+/* Prepare a statement with list parameters expanded. The statement is freed
+ with the connection's other statements */
+static PreparedStatement_T prepareList(const char *sql, void *ap) {
+        T C = ap;
+        PreparedStatement_T p = prepareStatement(C, "%s", sql);
+        if (! p)
+                THROW(SQLException, "%s", Connection_getLastError(C));
+        Vector_push(C->prepared, p);
+        return p;
+}
+
+
+/* Rewrite named parameters to ? and let the delegate prepare the statement. The
+ format string is rewritten, not the formatted statement, so arguments are not
+ scanned for names. SQLite binds named parameters natively and the statement is
+ not rewritten. A statement with list parameters is also formatted here so it
+ can be prepared again with the lists expanded */
+static PreparedStatement_T prepare(T C, const char *sql, va_list ap) {
+        PreparedStatement_T volatile p = NULL;
+        StringBuffer_T volatile f = NULL;
+        int volatile named = 0;
+        // Only MySQL uses backslash escapes in quoted strings by default
+        int escapes = Str_isEqual(C->op->name, "mysql");
+        int native = Str_isEqual(C->op->name, "sqlite");
+        StringBuffer_T s = StringBuffer_setEscapes(StringBuffer_new(sql), escapes);
+        Vector_T names = Vector_new(8);
+        TRY
+        {
+                if (strchr(sql, ':'))
+                        named = native ? StringBuffer_mapNamed(s, addNativeName, names) : StringBuffer_prepareNamed(s, addName, names);
+                // List positions count ? parameters only, which does not hold with native names
+                if (! (native && named) && StringBuffer_mapLists(s, NULL, NULL)) {
+                        va_list ap_copy;
+                        va_copy(ap_copy, ap);
+                        f = StringBuffer_vappend(StringBuffer_create(StringBuffer_length(s) + STRLEN), StringBuffer_toString(s), ap_copy);
+                        va_end(ap_copy);
+                }
+                p = C->op->prepareStatement(C->D, StringBuffer_toString(s), ap);
+                if (p && f)
+                        PreparedStatement_setLists(p, StringBuffer_toString(f), escapes, prepareList, C);
+        }
+        FINALLY
+        {
+                StringBuffer_T formatted = f;
+                if (formatted)
+                        StringBuffer_free(&formatted);
+                char **parameters = (char **)Vector_toArray(names);
+                if (p && named) {
+                        PreparedStatement_setNames(p, parameters);
+                } else {
+                        for (int i = 0; parameters[i]; i++)
+                                FREE(parameters[i]);
+                        FREE(parameters);
+                }
+                Vector_free(&names);
+                StringBuffer_free(&s);
+        }
+        END_TRY;
+        return p;
+}
+
+
 #ifdef PACKAGE_PROTECTED
 #pragma GCC visibility push(hidden)
 #endif
@@ -153,11 +273,14 @@ T Connection_new(void *pool, char **error) {
         C->isAvailable = true;
         C->isInTransaction = false;
         C->prepared = Vector_new(4);
+        C->blobs = Vector_new(4);
         C->timeout = SQL_DEFAULT_TIMEOUT;
         C->url = ConnectionPool_getURL(pool);
         C->lastAccessedTime = Time_now();
         if (! setDelegate(C, error))
                 Connection_free(&C);
+        else if (C->op->onreaper && ConnectionPool_hasReaper(pool))
+                C->op->onreaper(C->D);
 	return C;
 }
 
@@ -166,6 +289,7 @@ void Connection_free(T *C) {
         assert(C && *C);
         Connection_clear((*C));
         Vector_free(&(*C)->prepared);
+        Vector_free(&(*C)->blobs);
         if ((*C)->D)
                 (*C)->op->free(&(*C)->D);
 	FREE(*C);
@@ -191,11 +315,24 @@ time_t Connection_getLastAccessedTime(T C) {
 }
 
 
+void Connection_setLastAccessedTime(T C, time_t time) {
+        assert(C);
+        C->lastAccessedTime = time;
+}
+
+
 int Connection_isInTransaction(T C) {
         assert(C);
         return (C->isInTransaction > 0);
 }
 
+
+void Connection_onsweep(T C, int idle) {
+        assert(C);
+        if (C->op->onsweep)
+                C->op->onsweep(C->D, idle);
+}
+
 #ifdef PACKAGE_PROTECTED
 #pragma GCC visibility pop
 #endif
@@ -248,13 +385,8 @@ int Connection_ping(T C) {
 
 void Connection_clear(T C) {
         assert(C);
-        if (C->resultSet)
-                ResultSet_free(&C->resultSet);
-        if (C->maxRows)
-                Connection_setMaxRows(C, 0);
-        if (C->timeout != SQL_DEFAULT_TIMEOUT)
-                Connection_setQueryTimeout(C, SQL_DEFAULT_TIMEOUT);
-        freePrepared(C);
+        clear(C);
+        freeBlobs(C);
 }
 
 
@@ -276,6 +408,7 @@ void Connection_commit(T C) {
         assert(C);
         if (C->isInTransaction)
                 C->isInTransaction = 0;
+        closeBlobs(C);
         // Even if we are not in a transaction, call the delegate anyway and propagate any errors
         if (! C->op->commit(C->D)) 
                 THROW(SQLException, "%s", Connection_getLastError(C));
@@ -284,9 +417,10 @@ void Connection_commit(T C) {
 
 void Connection_rollback(T C) {
         assert(C);
+        closeBlobs(C);
         if (C->isInTransaction) {
                 // Clear any pending resultset statements first
-                Connection_clear(C);
+                clear(C);
                 C->isInTransaction = 0;
         }
         // Even if we are not in a transaction, call the delegate anyway and propagate any errors
@@ -340,7 +474,7 @@ PreparedStatement_T Connection_prepareStatement(T C, const char *sql, ...) {
         assert(sql);
         va_list ap;
         va_start(ap, sql);
-        PreparedStatement_T p = C->op->prepareStatement(C->D, sql, ap);
+        PreparedStatement_T p = strpbrk(sql, ":?") ? prepare(C, sql, ap) : C->op->prepareStatement(C->D, sql, ap);
         va_end(ap);
         if (p)
                 Vector_push(C->prepared, p);
@@ -350,6 +484,28 @@ PreparedStatement_T Connection_prepareStatement(T C, const char *sql, ...) {
 }
 
 
+Blob_T Connection_openBlob(T C, const char *table, const char *column, long long int rowid, int write) {
+        assert(C);
+        assert(table);
+        assert(column);
+        if (! C->op->openBlob)
+                THROW(SQLException, "Blob is not supported by %s", C->op->name);
+        Blob_T b = C->op->openBlob(C->D, table, column, rowid, write);
+        if (! b)
+                THROW(SQLException, "%s", Connection_getLastError(C));
+        Vector_push(C->blobs, b);
+        return b;
+}
+
+
+void Connection_mapStatistics(T C, void apply(const char *sql, long long int executions, const long long int counters[], void *ap), void *ap) {
+        assert(C);
+        assert(apply);
+        if (C->op->mapStatistics)
+                C->op->mapStatistics(C->D, apply, ap);
+}
+
+
 const char *Connection_getLastError(T C) {
 	assert(C);
 	const char *s = C->op->getLastError(C->D);
@@ -59,7 +59,7 @@
  *
  * <i>A Connection is reentrant, but not thread-safe and should only be used by one thread (at the time).</i>
  *
- * @see ResultSet.h PreparedStatement.h SQLException.h
+ * @see ResultSet.h PreparedStatement.h Blob.h SQLException.h
  * @file
  */
 
@@ -112,6 +112,16 @@ int Connection_isAvailable(T C);
 time_t Connection_getLastAccessedTime(T C);
 
 
+/**
+ * Set the last time this Connection was accessed from the Connection Pool.
+ * Used by the reaper thread to restore the time after a sweep, so an idle
+ * Connection reserved for a sweep is still reaped.
+ * @param C A Connection object
+ * @param time The last time (seconds) this Connection was accessed
+ */
+void Connection_setLastAccessedTime(T C, time_t time);
+
+
 /**
  * Return true if this Connection is in a transaction that has not
  * been committed.
@@ -121,6 +131,18 @@ time_t Connection_getLastAccessedTime(T C);
 int Connection_isInTransaction(T C);
 
 
+/**
+ * On sweep event handler called by the reaper thread once per sweep with 
+ * an available Connection from the pool. The Connection is reserved for 
+ * the reaper and the handler is called without holding the pool lock. Can
+ * be used by the database implementation to run maintenance tasks off the
+ * request path.
+ * @param C A Connection object
+ * @param idle true if no other Connection in the pool is in use
+ */
+void Connection_onsweep(T C, int idle);
+
+
 /**
  * On stop event handler called once by ConnectionPool_stop(). Can be used to 
  * gracefully finalise and release underlying libraries allocated resources.
@@ -312,19 +334,73 @@ ResultSet_T Connection_executeQuery(T C, const char *sql, ...) __attribute__((fo
  * setXXX methods. Only <i>one</i> SQL statement may be used in the sql 
  * parameter, this in difference to Connection_execute() which may 
  * take several statements. A PreparedStatement "lives" until the 
- * Connection is returned to the Connection Pool. 
+ * Connection is returned to the Connection Pool. Parameters may also be
+ * named, as in <code>:name</code>, and set with the PreparedStatement's
+ * setXXXByName methods, but a statement cannot use both '?' and named
+ * placeholders. A parameter in an IN list, <code>IN (?)</code>,
+ * may be set to a list of values, see PreparedStatement.h
  * @param C A Connection object
  * @param sql A single SQL statement that may contain one or more '?' 
- * IN parameter placeholders
+ * or <code>:name</code> IN parameter placeholders
  * @return A new PreparedStatement object containing the pre-compiled
  * SQL statement.
- * @exception SQLException if a database error occurs. 
+ * @exception SQLException if a database error occurs or if the statement
+ * mixes '?' and named placeholders
  * @see PreparedStatement.h
  * @see SQLException.h
  */
 PreparedStatement_T Connection_prepareStatement(T C, const char *sql, ...) __attribute__((format (printf, 2, 3)));
 
 
+/**
+ * Opens a Blob for incremental reading and writing of the binary value in
+ * <code>column</code> of the row with <code>rowid</code> in 
+ * <code>table</code>. Large values can then be streamed in chunks instead
+ * of being kept in memory as a whole. A Blob "lives" until it is closed
+ * with Blob_close() or until the Connection is returned to the Connection 
+ * Pool. Open Blobs are closed by Connection_commit() and 
+ * Connection_rollback(). Currently only supported by SQLite. 
+ * @param C A Connection object
+ * @param table The table name
+ * @param column The column name
+ * @param rowid The rowid of the row with the value
+ * @param write true to open the Blob for reading and writing, false to 
+ * open it read-only
+ * @return A new Blob object
+ * @exception SQLException if a database error occurs, for instance if the
+ * row does not exist, or if the database does not support Blob
+ * @see Blob.h
+ * @see SQLException.h
+ */
+Blob_T Connection_openBlob(T C, const char *table, const char *column, long long int rowid, int write);
+
+
+/**
+ * Apply the visitor function, <code>apply</code> for each SQL statement
+ * in the statement statistics for the database of this Connection. The 
+ * statistics are shared by all Connections in the pool and aggregate, per
+ * SQL text, the number of times a statement was executed and the sum of
+ * its counters. The <code>counters</code> array is indexed by SQLStatus_T
+ * and has SQL_STATUS_COUNT elements. A counter is -1 if not available.
+ * Counters of a statement are added when the statement is executed again
+ * or finalized. Currently only supported by SQLite if the URL option 
+ * <code>statistics=true</code> is set, otherwise this method does nothing.
+ * Example:
+ * <pre>
+ * static void print(const char *sql, long long int executions, const long long int counters[], void *ap) {
+ *         printf("%lld %lld %s\n", executions, counters[SQL_STATUS_FULLSCAN_STEP], sql);
+ * }
+ * ..
+ * Connection_mapStatistics(con, print, NULL);
+ * </pre>
+ * @param C A Connection object
+ * @param apply The function to apply
+ * @param ap An application-specific pointer passed to apply
+ * @see ResultSet_getStatus
+ */
+void Connection_mapStatistics(T C, void apply(const char *sql, long long int executions, const long long int counters[], void *ap), void *ap);
+
+
 /**
  * This method can be used to obtain a string describing the last
  * error that occurred. Inside a CATCH-block you can also find
@@ -56,6 +56,14 @@ typedef struct Cop_T {
 	ResultSet_T (*executeQuery)(T C, const char *sql, va_list ap);
         PreparedStatement_T (*prepareStatement)(T C, const char *sql, va_list ap);
         const char *(*getLastError)(T C);
+        // Optional methods, NULL if not supported
+        Blob_T (*openBlob)(T C, const char *table, const char *column, long long int rowid, int write);
+        // Event handler called by the reaper thread, see Connection_onsweep()
+        void (*onsweep)(T C, int idle);
+        // Event handler called when the Connection is created in a pool with a reaper thread
+        void (*onreaper)(T C);
+        // Optional, NULL if statement statistics are not supported
+        void (*mapStatistics)(T C, void apply(const char *sql, long long int executions, const long long int counters[], void *ap), void *ap);
 } *Cop_T;
 
 #undef T
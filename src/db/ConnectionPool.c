@@ -34,6 +34,7 @@
 #include "Vector.h"
 #include "ResultSet.h"
 #include "PreparedStatement.h"
+#include "Blob.h"
 #include "Connection.h"
 #include "ConnectionPool.h"
 
@@ -53,6 +54,7 @@ struct ConnectionPool_S {
         URL_T url;
         int filled;
         int doSweep;
+        int reaping;
         char *error;
         Sem_T alarm;
 	Mutex_T mutex;
@@ -131,6 +133,27 @@ static int reapConnections(T P) {
 }
 
 
+/* Sweep the database once with an available Connection. The Connection is reserved
+ and the pool lock released while sweeping so the request path is not stalled */
+static void sweepConnections(T P) {
+        int idle = (getActive(P) == 0);
+        for (int i = 0; i < Vector_size(P->pool); i++) {
+                Connection_T con = Vector_get(P->pool, i);
+                if (Connection_isAvailable(con)) {
+                        // A sweep is not a use, the Connection can still be reaped
+                        time_t lastAccessedTime = Connection_getLastAccessedTime(con);
+                        Connection_setAvailable(con, false);
+                        Mutex_unlock(P->mutex);
+                        Connection_onsweep(con, idle);
+                        Mutex_lock(P->mutex);
+                        Connection_setAvailable(con, true);
+                        Connection_setLastAccessedTime(con, lastAccessedTime);
+                        break;
+                }
+        }
+}
+
+
 static void *doSweep(void *args) {
         T P = args;
         struct timespec wait = {0, 0};
@@ -140,6 +163,7 @@ static void *doSweep(void *args) {
                 Sem_timeWait(P->alarm,  P->mutex, wait);
                 if (P->stopped) break;
                 reapConnections(P);
+                sweepConnections(P);
         }
         Mutex_unlock(P->mutex);
         DEBUG("Reaper thread stopped\n");
@@ -147,6 +171,23 @@ static void *doSweep(void *args) {
 }
 
 
+/* ----------------------------------------------------- Protected methods */
+
+
+#ifdef PACKAGE_PROTECTED
+#pragma GCC visibility push(hidden)
+#endif
+
+int ConnectionPool_hasReaper(T P) {
+        assert(P);
+        return P->reaping;
+}
+
+#ifdef PACKAGE_PROTECTED
+#pragma GCC visibility pop
+#endif
+
+
 /* ---------------------------------------------------------------- Public */
 
 
@@ -282,8 +323,9 @@ void ConnectionPool_start(T P) {
         {
                 P->stopped = false;
                 if (! P->filled) {
+                        P->reaping = P->doSweep;
                         P->filled = fillPool(P);
-                        if (P->filled && P->doSweep) {
+                        if (P->filled && P->reaping) {
                                 DEBUG("Starting Database reaper thread\n");
                                 Sem_init(P->alarm);
                                 Thread_create(P->reaper, doSweep, P);
@@ -302,20 +344,26 @@ void ConnectionPool_stop(T P) {
         LOCK(P->mutex)
         {
                 P->stopped = true;
-                if (P->filled) {
-                        drainPool(P);
-                        P->filled = false;
-                        stopSweep = (P->doSweep && P->reaper);
-                        Connection_onstop(P);
-                }
+                stopSweep = (P->filled && P->reaping);
         }
         END_LOCK;
+        /* Stop the reaper before the pool is drained as it may be using a Connection */
         if (stopSweep) {
                 DEBUG("Stopping Database reaper thread...\n");
                 Sem_signal(P->alarm);
                 Thread_join(P->reaper);
                 Sem_destroy(P->alarm);
         }
+        LOCK(P->mutex)
+        {
+                if (P->filled) {
+                        drainPool(P);
+                        P->filled = false;
+                        P->reaping = false;
+                        Connection_onstop(P);
+                }
+        }
+        END_LOCK;
 }
 
 
@@ -121,13 +121,50 @@
  * <ul>
  * <li><code>heap_limit=value</code> - Make SQLite auto-release unused memory 
  * if memory usage goes above the specified value [KB].</li> 
+ * <li><code>shared-cache=true|false</code> - Open the database in shared 
+ * cache mode. Default is true, except in high-concurrency mode. Shared cache
+ * serialize concurrent readers on table locks.</li>
+ * <li><code>no-mutex=true|false</code> - Open the database without SQLite's 
+ * internal mutexes. This is safe since a Connection is only used by one thread
+ * at the time. Default is false, except in high-concurrency mode.</li>
+ * <li><code>read-only=true</code> - Open the database read-only.</li>
+ * <li><code>uri=true</code> - Interpret the database path as a 
+ * <a href="http://sqlite.org/uri.html">SQLite URI filename</a>.</li>
+ * <li><code>high-concurrency=true</code> - A preset for multi-threaded 
+ * programs. Turns off shared cache, turns on no-mutex and set the pragmas 
+ * <code>journal_mode=WAL</code>, <code>synchronous=NORMAL</code> and 
+ * <code>mmap_size=268435456</code>. Pragmas given in the URL override
+ * the preset.</li>
+ * <li><code>single-writer=true</code> - All Connections to the database 
+ * share one writer. Writes outside a transaction are queued and a writer 
+ * thread executes them grouped together in one transaction, each in its
+ * own savepoint. A transaction started with Connection_beginTransaction()
+ * has exclusive use of the writer until commit or rollback, so writes from 
+ * other Connections wait for it to end, at most the query timeout, see
+ * Connection_setQueryTimeout(), and transactions should be kept short.
+ * Queries run in parallel on each Connection's own database handle
+ * in WAL mode, except inside a transaction where queries and statements 
+ * prepared run on the writer to see the transaction's changes. A ResultSet
+ * of a statement prepared on the writer, such as <code>INSERT .. RETURNING</code>,
+ * has exclusive use of the writer until it is freed. Shared cache is off by default in this mode.</li>
+ * <li><code>statistics=true</code> - Aggregate statement counters per SQL 
+ * text for profiling, see Connection_mapStatistics()</li>
+ * <li><code>reaper-checkpoint=true</code> - Leave WAL checkpoints to the
+ * reaper thread and turn off automatic checkpoints in the committing 
+ * Connection. Only used if the pool has a reaper thread. Default is false.</li>
  * </ul>
+ * If the pool is started with a reaper thread, see ConnectionPool_setReaper(),
+ * the reaper also checkpoints the SQLite WAL at each sweep. The checkpoint is
+ * passive while Connections are in use and truncates the WAL when the pool
+ * is idle.
  * An URL for 
  * connecting to a SQLite database might look like:
  *
  * \htmlonly
  * <dt><dd><code>
- * sqlite:///var/sqlite/test.db?synchronous=normal&heap_limit=8000&foreign_keys=on
+ * sqlite:///var/sqlite/test.db?synchronous=normal&heap_limit=8000&foreign_keys=on<br/>
+ * sqlite:///var/sqlite/test.db?high-concurrency=true&mmap_size=1073741824<br/>
+ * sqlite:///var/sqlite/test.db?single-writer=true&synchronous=normal
  * </code></dd></dt>
  * \endhtmlonly
  *
@@ -248,6 +285,17 @@
 #define T ConnectionPool_T
 typedef struct ConnectionPool_S *T;
 
+//<< Protected methods
+
+/**
+ * Returns true if the pool was started with a reaper thread
+ * @param P A ConnectionPool object
+ * @return true if the pool has a reaper thread, otherwise false
+ */
+int ConnectionPool_hasReaper(T P);
+
+//>> End Protected methods
+
 /**
  * Library Debug flag. If set to true, emit debug output 
  */
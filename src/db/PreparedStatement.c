@@ -26,7 +26,11 @@
 #include "Config.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
 
+#include "Vector.h"
+#include "StringBuffer.h"
 #include "ResultSet.h"
 #include "PreparedStatement.h"
 
@@ -41,9 +45,51 @@
 /* ----------------------------------------------------------- Definitions */
 
 
+typedef enum {
+        ValueType_None = 0,
+        ValueType_String,
+        ValueType_LLong,
+        ValueType_Double,
+        ValueType_Blob,
+        ValueType_LLongArray,
+        ValueType_StringArray
+} ValueType_T;
+
+typedef struct value_t {
+        ValueType_T type;
+        int size;
+        union {
+                long long int ll;
+                double d;
+                const void *p;
+        } u;
+} *value_t;
+
+typedef struct variant_t {
+        int *sizes;
+        PreparedStatement_T P;
+} *variant_t;
+
 #define T PreparedStatement_T
 struct PreparedStatement_S {
         Pop_T op;
+        int mask;
+        int *names;
+        int *next;
+        char **parameters;
+        int streamCount;
+        void **streams;
+        char *sql;
+        int escapes;
+        int listCount;
+        int *lists;
+        int *sizes;
+        int valueCount;
+        value_t values;
+        Vector_T variants;
+        PreparedStatement_T (*prepare)(const char *sql, void *ap);
+        void *ap;
+        PreparedStatement_T variant;
         ResultSet_T resultSet;
         PreparedStatementDelegate_T D;
 };
@@ -52,9 +98,176 @@ struct PreparedStatement_S {
 /* ------------------------------------------------------- Private methods */
 
 
+/* Also free the result of the variant last executed, see getVariant() */
 static void clearResultSet(T P) {
         if (P->resultSet)
                 ResultSet_free(&P->resultSet);
+        if (P->variant) {
+                clearResultSet(P->variant);
+                P->variant = NULL;
+        }
+}
+
+
+static inline unsigned int hash(const char *name) {
+        unsigned int h = 2166136261U;
+        while (*name)
+                h = (h ^ (unsigned char)*name++) * 16777619U;
+        return h;
+}
+
+
+/* Return the first position of the named parameter. Further positions with the
+ same name are chained in next, a position of 0 ends the chain */
+static inline int getIndex(T P, const char *name) {
+        if (name && P->names) {
+                for (unsigned int h = hash(name) & P->mask; P->names[h]; h = (h + 1) & P->mask)
+                        if (Str_isByteEqual(name, P->parameters[P->names[h] - 1]))
+                                return P->names[h];
+        }
+        THROW(SQLException, "Invalid parameter name '%s'", name ? name : "null");
+        return -1;
+}
+
+
+/* Read a blob stream into a buffer kept per parameter until the statement
+ is freed or the parameter is streamed again. Used if the database cannot
+ stream a parameter, see PreparedStatement_setBlobStream(). The delegate
+ checks the index against its parameter count before the stream is read */
+static void readStream(T P, int parameterIndex, long read(void *buffer, long length, void *ap), void *ap) {
+        long n, size = 0, capacity = STRLEN;
+        P->op->setString(P->D, parameterIndex, NULL);
+        if (parameterIndex > P->streamCount) {
+                if (P->streams)
+                        RESIZE(P->streams, parameterIndex * sizeof(void *));
+                else
+                        P->streams = ALLOC(parameterIndex * sizeof(void *));
+                for (int i = P->streamCount; i < parameterIndex; i++)
+                        P->streams[i] = NULL;
+                P->streamCount = parameterIndex;
+        }
+        char *buffer = ALLOC(capacity);
+        while ((n = read(buffer + size, capacity - size, ap)) > 0) {
+                size += n;
+                if (size == capacity) {
+                        if (capacity > INT_MAX / 2) {
+                                FREE(buffer);
+                                THROW(SQLException, "Blob stream is too large");
+                        }
+                        capacity *= 2;
+                        RESIZE(buffer, capacity);
+                }
+        }
+        if (n < 0) {
+                FREE(buffer);
+                THROW(SQLException, "Error reading blob stream");
+        }
+        FREE(P->streams[parameterIndex - 1]);
+        P->streams[parameterIndex - 1] = buffer;
+        PreparedStatement_setBlob(P, parameterIndex, buffer, (int)size);
+}
+
+
+/* Keep a parameter value of a statement with list parameters until the
+ statement is executed, see getVariant() */
+static value_t setValue(T P, int parameterIndex, ValueType_T type) {
+        if (parameterIndex < 1)
+                THROW(SQLException, "Parameter index is out of range");
+        if (parameterIndex > P->valueCount) {
+                if (P->values)
+                        RESIZE(P->values, parameterIndex * sizeof *P->values);
+                else
+                        P->values = ALLOC(parameterIndex * sizeof *P->values);
+                memset(P->values + P->valueCount, 0, (parameterIndex - P->valueCount) * sizeof *P->values);
+                P->valueCount = parameterIndex;
+        }
+        P->values[parameterIndex - 1].type = type;
+        return &P->values[parameterIndex - 1];
+}
+
+
+static void addList(int parameterIndex, void *ap) {
+        T P = ap;
+        P->lists[P->listCount++] = parameterIndex;
+}
+
+
+/* Return the statement to execute for the number of values in each list. The
+ statement as prepared is used if all lists have one value, otherwise each list
+ is expanded to the next power of two parameters and the statement prepared for
+ these sizes is used. Lists of up to n values thus use at most log2(n) + 1 
+ statements, which the database can cache, instead of one per list length */
+static PreparedStatement_T getVariant(T P) {
+        int expanded = false;
+        for (int k = 0; k < P->listCount; k++) {
+                int i = P->lists[k] - 1, count = 1;
+                if (i < P->valueCount && (P->values[i].type == ValueType_LLongArray || P->values[i].type == ValueType_StringArray))
+                        count = P->values[i].size;
+                for (P->sizes[k] = 1; P->sizes[k] < count; P->sizes[k] <<= 1) ;
+                expanded |= (P->sizes[k] > 1);
+        }
+        if (! expanded)
+                return NULL;
+        for (int j = 0; j < Vector_size(P->variants); j++) {
+                variant_t v = Vector_get(P->variants, j);
+                if (memcmp(v->sizes, P->sizes, P->listCount * sizeof *P->sizes) == 0)
+                        return v->P;
+        }
+        PreparedStatement_T volatile V = NULL;
+        StringBuffer_T s = StringBuffer_setEscapes(StringBuffer_new(P->sql), P->escapes);
+        TRY
+        {
+                StringBuffer_expandLists(s, P->sizes);
+                V = P->prepare(StringBuffer_toString(s), P->ap);
+        }
+        FINALLY
+        {
+                StringBuffer_free(&s);
+        }
+        END_TRY;
+        variant_t v;
+        NEW(v);
+        v->P = V;
+        v->sizes = ALLOC(P->listCount * sizeof *v->sizes);
+        memcpy(v->sizes, P->sizes, P->listCount * sizeof *v->sizes);
+        Vector_push(P->variants, v);
+        return V;
+}
+
+
+/* Set value j of v, a list is padded with its last value */
+static void bindValue(Pop_T op, PreparedStatementDelegate_T D, int parameterIndex, value_t v, int j) {
+        switch (v->type) {
+                case ValueType_String: op->setString(D, parameterIndex, v->u.p); break;
+                case ValueType_LLong: op->setLLong(D, parameterIndex, v->u.ll); break;
+                case ValueType_Double: op->setDouble(D, parameterIndex, v->u.d); break;
+                case ValueType_Blob: op->setBlob(D, parameterIndex, v->u.p, v->size); break;
+                case ValueType_LLongArray:
+                        op->setLLong(D, parameterIndex, ((const long long int *)v->u.p)[j < v->size ? j : v->size - 1]);
+                        break;
+                case ValueType_StringArray:
+                        op->setString(D, parameterIndex, ((const char **)v->u.p)[j < v->size ? j : v->size - 1]);
+                        break;
+                default: break;
+        }
+}
+
+
+/* Bind the values kept to the statement V, or to this statement if V is NULL.
+ Each position after a list is moved by the number of parameters it expands to */
+static void bind(T P, PreparedStatement_T V) {
+        Pop_T op = V ? V->op : P->op;
+        PreparedStatementDelegate_T D = V ? V->D : P->D;
+        for (int i = 0, k = 0, parameterIndex = 1; i < P->valueCount; i++) {
+                int size = 0;
+                if (k < P->listCount && P->lists[k] == i + 1)
+                        size = P->sizes[k++];
+                else if (P->values[i].type == ValueType_LLongArray || P->values[i].type == ValueType_StringArray)
+                        THROW(SQLException, "Parameter %d is not a list parameter", i + 1);
+                for (int j = 0; j < (size ? size : 1); j++)
+                        bindValue(op, D, parameterIndex + j, &P->values[i], j);
+                parameterIndex += size ? size : 1;
+        }
 }
 
 
@@ -78,11 +291,84 @@ T PreparedStatement_new(PreparedStatementDelegate_T D, Pop_T op) {
 
 void PreparedStatement_free(T *P) {
 	assert(P && *P);
+        // The variants are owned by the connection and may already be freed
+        (*P)->variant = NULL;
         clearResultSet((*P));
         (*P)->op->free(&(*P)->D);
+        for (int i = 0; i < (*P)->streamCount; i++)
+                FREE((*P)->streams[i]);
+        FREE((*P)->streams);
+        if ((*P)->parameters) {
+                for (int i = 0; (*P)->parameters[i]; i++)
+                        FREE((*P)->parameters[i]);
+                FREE((*P)->parameters);
+        }
+        FREE((*P)->names);
+        FREE((*P)->next);
+        if ((*P)->variants) {
+                // The statements are owned by the connection
+                while (! Vector_isEmpty((*P)->variants)) {
+                        variant_t v = Vector_pop((*P)->variants);
+                        FREE(v->sizes);
+                        FREE(v);
+                }
+                Vector_free(&(*P)->variants);
+        }
+        FREE((*P)->sql);
+        FREE((*P)->lists);
+        FREE((*P)->sizes);
+        FREE((*P)->values);
 	FREE(*P);
 }
 
+
+/* Build an open addressing hash table of parameter names where each name maps
+ to its first position. Positions are added in reverse so chains are in order */
+void PreparedStatement_setNames(T P, char **names) {
+        assert(P);
+        assert(names);
+        int count = 0;
+        while (names[count])
+                count++;
+        P->parameters = names;
+        for (P->mask = 1; P->mask < 2 * count; P->mask <<= 1) ;
+        P->names = CALLOC(P->mask, sizeof *P->names);
+        P->next = CALLOC(count ? count : 1, sizeof *P->next);
+        P->mask--;
+        for (int i = count; i > 0; i--) {
+                unsigned int h = hash(names[i - 1]) & P->mask;
+                while (P->names[h] && ! Str_isByteEqual(names[i - 1], names[P->names[h] - 1]))
+                        h = (h + 1) & P->mask;
+                P->next[i - 1] = P->names[h];
+                P->names[h] = i;
+        }
+}
+
+
+
+/* Keep the statement if it has list parameters and the delegate cannot bind an
+ array, so it can be prepared again with the lists expanded */
+void PreparedStatement_setLists(T P, const char *sql, int escapes, PreparedStatement_T prepare(const char *sql, void *ap), void *ap) {
+        assert(P);
+        assert(sql);
+        assert(prepare);
+        if (P->op->setLLongArray)
+                return;
+        StringBuffer_T s = StringBuffer_setEscapes(StringBuffer_new(sql), escapes);
+        int count = StringBuffer_mapLists(s, NULL, NULL);
+        if (count) {
+                P->lists = ALLOC(count * sizeof *P->lists);
+                P->sizes = ALLOC(count * sizeof *P->sizes);
+                StringBuffer_mapLists(s, addList, P);
+                P->sql = Str_dup(sql);
+                P->escapes = escapes;
+                P->variants = Vector_new(4);
+                P->prepare = prepare;
+                P->ap = ap;
+        }
+        StringBuffer_free(&s);
+}
+
 #ifdef PACKAGE_PROTECTED
 #pragma GCC visibility pop
 #endif
@@ -93,37 +379,148 @@ void PreparedStatement_free(T *P) {
 
 void PreparedStatement_setString(T P, int parameterIndex, const char *x) {
 	assert(P);
-        P->op->setString(P->D, parameterIndex, x);
+        if (P->sql)
+                setValue(P, parameterIndex, ValueType_String)->u.p = x;
+        else
+                P->op->setString(P->D, parameterIndex, x);
 }
 
 
 void PreparedStatement_setInt(T P, int parameterIndex, int x) {
 	assert(P);
-        P->op->setInt(P->D, parameterIndex, x);
+        if (P->sql)
+                setValue(P, parameterIndex, ValueType_LLong)->u.ll = x;
+        else
+                P->op->setInt(P->D, parameterIndex, x);
 }
 
 
 void PreparedStatement_setLLong(T P, int parameterIndex, long long int x) {
 	assert(P);
-        P->op->setLLong(P->D, parameterIndex, x);
+        if (P->sql)
+                setValue(P, parameterIndex, ValueType_LLong)->u.ll = x;
+        else
+                P->op->setLLong(P->D, parameterIndex, x);
 }
 
 
 void PreparedStatement_setDouble(T P, int parameterIndex, double x) {
 	assert(P);
-        P->op->setDouble(P->D, parameterIndex, x);
+        if (P->sql)
+                setValue(P, parameterIndex, ValueType_Double)->u.d = x;
+        else
+                P->op->setDouble(P->D, parameterIndex, x);
 }
 
 
 void PreparedStatement_setBlob(T P, int parameterIndex, const void *x, int size) {
 	assert(P);
-        P->op->setBlob(P->D, parameterIndex, x, size);
+        if (P->sql) {
+                value_t v = setValue(P, parameterIndex, ValueType_Blob);
+                v->u.p = x;
+                v->size = size;
+        } else {
+                P->op->setBlob(P->D, parameterIndex, x, size);
+        }
+}
+
+
+void PreparedStatement_setLLongArray(T P, int parameterIndex, const long long int *x, int count) {
+	assert(P);
+        assert(x || count == 0);
+        assert(count >= 0);
+        // NOT IN with no values would be NULL when expanded but true as <> ALL('{}')
+        if (count == 0)
+                THROW(SQLException, "Parameter %d is an empty list", parameterIndex);
+        if (P->sql) {
+                value_t v = setValue(P, parameterIndex, ValueType_LLongArray);
+                v->u.p = x;
+                v->size = count;
+        } else if (P->op->setLLongArray) {
+                P->op->setLLongArray(P->D, parameterIndex, x, count);
+        } else {
+                THROW(SQLException, "Parameter %d is not a list parameter", parameterIndex);
+        }
+}
+
+
+void PreparedStatement_setStringArray(T P, int parameterIndex, const char **x, int count) {
+	assert(P);
+        assert(x || count == 0);
+        assert(count >= 0);
+        // NOT IN with no values would be NULL when expanded but true as <> ALL('{}')
+        if (count == 0)
+                THROW(SQLException, "Parameter %d is an empty list", parameterIndex);
+        if (P->sql) {
+                value_t v = setValue(P, parameterIndex, ValueType_StringArray);
+                v->u.p = x;
+                v->size = count;
+        } else if (P->op->setStringArray) {
+                P->op->setStringArray(P->D, parameterIndex, x, count);
+        } else {
+                THROW(SQLException, "Parameter %d is not a list parameter", parameterIndex);
+        }
+}
+
+
+void PreparedStatement_setBlobStream(T P, int parameterIndex, long read(void *buffer, long length, void *ap), void *ap) {
+	assert(P);
+        assert(read);
+        // A statement with list parameters keeps the value until it is executed
+        if (P->op->setBlobStream && ! P->sql)
+                P->op->setBlobStream(P->D, parameterIndex, read, ap);
+        else
+                readStream(P, parameterIndex, read, ap);
+}
+
+
+void PreparedStatement_setStringByName(T P, const char *parameterName, const char *x) {
+	assert(P);
+        for (int i = getIndex(P, parameterName); i; i = P->next[i - 1])
+                PreparedStatement_setString(P, i, x);
+}
+
+
+void PreparedStatement_setIntByName(T P, const char *parameterName, int x) {
+	assert(P);
+        for (int i = getIndex(P, parameterName); i; i = P->next[i - 1])
+                PreparedStatement_setInt(P, i, x);
+}
+
+
+void PreparedStatement_setLLongByName(T P, const char *parameterName, long long int x) {
+	assert(P);
+        for (int i = getIndex(P, parameterName); i; i = P->next[i - 1])
+                PreparedStatement_setLLong(P, i, x);
+}
+
+
+void PreparedStatement_setDoubleByName(T P, const char *parameterName, double x) {
+	assert(P);
+        for (int i = getIndex(P, parameterName); i; i = P->next[i - 1])
+                PreparedStatement_setDouble(P, i, x);
+}
+
+
+void PreparedStatement_setBlobByName(T P, const char *parameterName, const void *x, int size) {
+	assert(P);
+        for (int i = getIndex(P, parameterName); i; i = P->next[i - 1])
+                PreparedStatement_setBlob(P, i, x, size);
 }
 
 
 void PreparedStatement_execute(T P) {
 	assert(P);
         clearResultSet(P);
+        if (P->sql) {
+                PreparedStatement_T V = getVariant(P);
+                bind(P, V);
+                if (V) {
+                        PreparedStatement_execute(V);
+                        P->variant = V;
+                        return;
+                }
+        }
         P->op->execute(P->D);
 }
 
@@ -131,9 +528,25 @@ void PreparedStatement_execute(T P) {
 ResultSet_T PreparedStatement_executeQuery(T P) {
 	assert(P);
         clearResultSet(P);
+        if (P->sql) {
+                PreparedStatement_T V = getVariant(P);
+                bind(P, V);
+                if (V) {
+                        ResultSet_T r = PreparedStatement_executeQuery(V);
+                        P->variant = V;
+                        return r;
+                }
+        }
 	P->resultSet = P->op->executeQuery(P->D);
         if (! P->resultSet)
                 THROW(SQLException, "PreparedStatement_executeQuery");
         return P->resultSet;
 }
 
+
+long long int PreparedStatement_getStatus(T P, SQLStatus_T counter) {
+	assert(P);
+        assert(counter >= 0 && counter < SQL_STATUS_COUNT);
+	return P->op->getStatus ? P->op->getStatus(P->D, counter) : -1;
+}
+
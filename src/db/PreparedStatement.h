@@ -93,6 +93,36 @@
  * the Prepared Statement is executed again or until the Connection is
  * returned to the Connection Pool. 
  *
+ * <h3>Named parameters:</h3>
+ * Parameters can also be named, using the form <code>:name</code>. A name
+ * starts with a letter or underscore and may be used more than once in a
+ * statement. The statement is rewritten to use '?' parameters once, when it
+ * is prepared, and the ByName setter methods set the value of each position
+ * the name is used at. Named parameters can still be set by index, which is
+ * the sequence of the parameter in the statement as above. SQLite binds 
+ * named parameters natively and the statement is not rewritten. There, a 
+ * name used more than once has the index of its first use, as in SQLite,
+ * named and '?' parameters may be mixed, and list parameters cannot be used
+ * together with named parameters.
+ * <pre>
+ * PreparedStatement_T p = Connection_prepareStatement(con, "SELECT id FROM employee WHERE name LIKE :name OR nick LIKE :name"); 
+ * PreparedStatement_setStringByName(p, "name", "%Kaoru%");
+ * ResultSet_T r = PreparedStatement_executeQuery(p);
+ * </pre>
+ *
+ * <h3>List parameters:</h3>
+ * A '?' parameter which is the only item of an IN list, as in 
+ * <code>id IN (?)</code> or <code>id NOT IN (?)</code>, is a list parameter 
+ * and can be set to any number of values with PreparedStatement_setLLongArray()
+ * or PreparedStatement_setStringArray(), so the same statement is used for
+ * lists of any length.
+ * <pre>
+ * long long int ids[] = {3, 5, 8, 13};
+ * PreparedStatement_T p = Connection_prepareStatement(con, "SELECT name FROM employee WHERE id IN (?)"); 
+ * PreparedStatement_setLLongArray(p, 1, ids, 4);
+ * ResultSet_T r = PreparedStatement_executeQuery(p);
+ * </pre>
+ *
  * <i>A PreparedStatement is reentrant, but not thread-safe and should only be used by one thread (at the time).</i>
  * 
  * @see Connection.h ResultSet.h SQLException.h
@@ -120,6 +150,32 @@ T PreparedStatement_new(PreparedStatementDelegate_T D, Pop_T op);
  */
 void PreparedStatement_free(T *P);
 
+
+/**
+ * Set the parameter names of a statement prepared with named parameters.
+ * The PreparedStatement takes ownership of the array and its strings.
+ * @param P A PreparedStatement object
+ * @param names A NULL terminated array with the name of each parameter
+ * in order. A name is listed once for each position it is used at
+ */
+void PreparedStatement_setNames(T P, char **names);
+
+
+/**
+ * Set the statement of a PreparedStatement with list parameters, see 
+ * PreparedStatement_setLLongArray(). Unless the delegate can bind arrays,
+ * the statement is kept and prepared again, by calling <code>prepare</code>,
+ * with each list expanded to the number of parameters needed. 
+ * @param P A PreparedStatement object
+ * @param sql The SQL statement as prepared
+ * @param escapes true if a backslash escapes the next character in quoted
+ * strings, see StringBuffer_setEscapes()
+ * @param prepare The function used to prepare a statement with expanded 
+ * lists. The statement returned is owned by the caller
+ * @param ap An application-specific pointer passed to prepare
+ */
+void PreparedStatement_setLists(T P, const char *sql, int escapes, PreparedStatement_T prepare(const char *sql, void *ap), void *ap);
+
 //>> End Protected methods
 
 /**
@@ -189,6 +245,146 @@ void PreparedStatement_setDouble(T P, int parameterIndex, double x);
 void PreparedStatement_setBlob(T P, int parameterIndex, const void *x, int size);
 
 
+/**
+ * Sets the list parameter at index <code>parameterIndex</code> to the
+ * given long long values. A list parameter is a '?' which is the only item
+ * of an IN list, such as <code>id IN (?)</code>. With PostgreSQL the list is
+ * compared with a single array parameter, <code>id = ANY($1)</code>, which is
+ * sent in binary format for integer columns. Other databases prepare the
+ * statement again with the list expanded to the next power of two number of
+ * parameters, padded with the last value, so lists of up to n values use at
+ * most log2(n) + 1 statements. Values are set by reference, as with strings,
+ * and must not "disappear" before the statement is executed. A list must
+ * have at least one value, as SQL has no empty IN list. A list parameter may
+ * also be set to a single value with the other setter methods. With 
+ * PostgreSQL a blob set to a list parameter is a list of one bytea value.
+ * @param P A PreparedStatement object
+ * @param parameterIndex The first parameter is 1, the second is 2,..
+ * @param x The values to set
+ * @param count The number of values in x, at least 1
+ * @exception SQLException if a database access error occurs, if parameter 
+ * index is out of range, is not a list parameter or if count is 0
+ * @see SQLException.h
+ */
+void PreparedStatement_setLLongArray(T P, int parameterIndex, const long long int *x, int count);
+
+
+/**
+ * Sets the list parameter at index <code>parameterIndex</code> to the
+ * given string values. See PreparedStatement_setLLongArray(). With 
+ * PostgreSQL the array is sent in binary format for text columns.
+ * @param P A PreparedStatement object
+ * @param parameterIndex The first parameter is 1, the second is 2,..
+ * @param x The string values to set. NULL is allowed to indicate a SQL NULL 
+ * value. The array and the strings must not "disappear" before the statement
+ * is executed
+ * @param count The number of values in x, at least 1
+ * @exception SQLException if a database access error occurs, if parameter 
+ * index is out of range, is not a list parameter or if count is 0
+ * @see SQLException.h
+ */
+void PreparedStatement_setStringArray(T P, int parameterIndex, const char **x, int count);
+
+
+/**
+ * Sets the <i>in</i> parameter at index <code>parameterIndex</code> to a
+ * blob value read from a stream. The function <code>read</code> is called
+ * repeatedly to fill <code>buffer</code> with at most <code>length</code>
+ * bytes of the value and should return the number of bytes read, 0 at the
+ * end of the value or -1 on error. With MySQL the value is read in chunks
+ * and sent to the server when the statement is executed, so a large value
+ * is uploaded in constant memory and is not limited by max_allowed_packet.
+ * The stream is consumed by the execute and must be set again before the 
+ * statement is executed again. Other databases read the whole value into memory when this method is 
+ * called and set it as with PreparedStatement_setBlob(). With SQLite, use
+ * Connection_openBlob() to write a large value in constant memory.
+ * Example:
+ * <pre>
+ * static long readFile(void *buffer, long length, void *ap) {
+ *         return (long)fread(buffer, 1, length, (FILE *)ap);
+ * }
+ * ..
+ * PreparedStatement_setBlobStream(p, 2, readFile, file);
+ * PreparedStatement_execute(p);
+ * </pre>
+ * @param P A PreparedStatement object
+ * @param parameterIndex The first parameter is 1, the second is 2,..
+ * @param read The function which reads the value
+ * @param ap An application-specific pointer passed to read
+ * @exception SQLException if a database access error occurs, if parameter 
+ * index is out of range or if read returns -1
+ * @see SQLException.h
+ */
+void PreparedStatement_setBlobStream(T P, int parameterIndex, long read(void *buffer, long length, void *ap), void *ap);
+
+
+/**
+ * Sets all <i>in</i> parameters named <code>parameterName</code> to the
+ * given string value. 
+ * @param P A PreparedStatement object
+ * @param parameterName The name of the parameter, without the leading ':'
+ * @param x The string value to set. Must be a NUL terminated string. NULL
+ * is allowed to indicate a SQL NULL value. 
+ * @exception SQLException if a database access error occurs or if the
+ * statement has no parameter named parameterName
+ * @see SQLException.h
+ */
+void PreparedStatement_setStringByName(T P, const char *parameterName, const char *x);
+
+
+/**
+ * Sets all <i>in</i> parameters named <code>parameterName</code> to the
+ * given int value. 
+ * @param P A PreparedStatement object
+ * @param parameterName The name of the parameter, without the leading ':'
+ * @param x The int value to set
+ * @exception SQLException if a database access error occurs or if the
+ * statement has no parameter named parameterName
+ * @see SQLException.h
+ */
+void PreparedStatement_setIntByName(T P, const char *parameterName, int x);
+
+
+/**
+ * Sets all <i>in</i> parameters named <code>parameterName</code> to the
+ * given long long value. 
+ * @param P A PreparedStatement object
+ * @param parameterName The name of the parameter, without the leading ':'
+ * @param x The long long value to set
+ * @exception SQLException if a database access error occurs or if the
+ * statement has no parameter named parameterName
+ * @see SQLException.h
+ */
+void PreparedStatement_setLLongByName(T P, const char *parameterName, long long int x);
+
+
+/**
+ * Sets all <i>in</i> parameters named <code>parameterName</code> to the
+ * given double value. 
+ * @param P A PreparedStatement object
+ * @param parameterName The name of the parameter, without the leading ':'
+ * @param x The double value to set
+ * @exception SQLException if a database access error occurs or if the
+ * statement has no parameter named parameterName
+ * @see SQLException.h
+ */
+void PreparedStatement_setDoubleByName(T P, const char *parameterName, double x);
+
+
+/**
+ * Sets all <i>in</i> parameters named <code>parameterName</code> to the
+ * given blob value. 
+ * @param P A PreparedStatement object
+ * @param parameterName The name of the parameter, without the leading ':'
+ * @param x The blob value to set
+ * @param size The number of bytes in the blob 
+ * @exception SQLException if a database access error occurs or if the
+ * statement has no parameter named parameterName
+ * @see SQLException.h
+ */
+void PreparedStatement_setBlobByName(T P, const char *parameterName, const void *x, int size);
+
+
 /**
  * Executes the prepared SQL statement, which may be an INSERT, UPDATE,
  * or DELETE statement or an SQL statement that returns nothing, such
@@ -215,5 +411,16 @@ void PreparedStatement_execute(T P);
 ResultSet_T PreparedStatement_executeQuery(T P);
 
 
+/**
+ * Returns the value of a statement counter for the last execution of this
+ * PreparedStatement. See SQLStatus_T in ResultSet.h for the counters.
+ * @param P A PreparedStatement object
+ * @param counter The counter to return
+ * @return The counter value or -1 if the counter is not available
+ * for this database
+ */
+long long int PreparedStatement_getStatus(T P, SQLStatus_T counter);
+
+
 #undef T
 #endif
@@ -47,6 +47,11 @@ typedef struct Pop_T {
         void (*setBlob)(T P, int parameterIndex, const void *x, int size);
         void (*execute)(T P);
         ResultSet_T (*executeQuery)(T P);
+        // Optional methods, NULL if not supported
+        long long int (*getStatus)(T P, int counter);
+        void (*setBlobStream)(T P, int parameterIndex, long read(void *buffer, long length, void *ap), void *ap);
+        void (*setLLongArray)(T P, int parameterIndex, const long long int *x, int count);
+        void (*setStringArray)(T P, int parameterIndex, const char **x, int count);
 } *Pop_T;
 
 #undef T
@@ -26,6 +26,7 @@
 #include "Config.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "ResultSet.h"
 
@@ -43,6 +44,13 @@
 #define T ResultSet_T
 struct ResultSet_S {
         Rop_T op;
+        int stop;
+        int mask;
+        int *names;
+        int blobColumn;
+        int blobSize;
+        const void *blob;
+        RowBuffer_T batch;
         ResultSetDelegate_T D;
 };
 
@@ -50,12 +58,96 @@ struct ResultSet_S {
 /* ------------------------------------------------------- Private methods */
 
 
-static inline int getIndex(T R, const char *name) {
-        int i;
+static inline unsigned int hash(const char *name) {
+        unsigned int h = 2166136261U;
+        while (*name)
+                h = (h ^ (unsigned char)*name++) * 16777619U;
+        return h;
+}
+
+
+/* Build an open addressing hash table of column indices, keyed on column name. Columns
+ are added in order so a lookup finds the first of several columns with the same name */
+static void buildIndex(T R) {
         int columns = ResultSet_getColumnCount(R);
-        for (i = 1; i <= columns; i++)
-                if (Str_isByteEqual(name, ResultSet_getColumnName(R, i)))
-                        return i;
+        for (R->mask = 1; R->mask < 2 * columns; R->mask <<= 1) ;
+        R->names = CALLOC(R->mask, sizeof *R->names);
+        R->mask--;
+        for (int i = 1; i <= columns; i++) {
+                const char *name = ResultSet_getColumnName(R, i);
+                if (name) {
+                        unsigned int h = hash(name) & R->mask;
+                        while (R->names[h])
+                                h = (h + 1) & R->mask;
+                        R->names[h] = i;
+                }
+        }
+}
+
+
+/* Read part of a blob from the value retrieved with the delegate's getBlob
+ method. The value is kept until the row changes so it is only retrieved, and
+ for Postgres unescaped, once */
+static int readBlob(T R, int columnIndex, void *buffer, int size, int offset) {
+        if (R->blobColumn != columnIndex) {
+                R->blob = R->op->getBlob(R->D, columnIndex, &R->blobSize);
+                if (! R->blob)
+                        R->blobSize = 0;
+                R->blobColumn = columnIndex;
+        }
+        if (offset >= R->blobSize)
+                return 0;
+        if (size > R->blobSize - offset)
+                size = R->blobSize - offset;
+        memcpy(buffer, (const char *)R->blob + offset, size);
+        return size;
+}
+
+
+/* Prepare the row buffer for a batch of maxRows rows */
+static void resetBatch(T R, int maxRows) {
+        int columns = R->op->getColumnCount(R->D);
+        if (! R->batch)
+                NEW(R->batch);
+        RowBuffer_T B = R->batch;
+        if (maxRows * columns > B->capacity) {
+                B->capacity = maxRows * columns;
+                FREE(B->offsets);
+                FREE(B->lengths);
+                FREE(B->nulls);
+                B->offsets = ALLOC(B->capacity * sizeof *B->offsets);
+                B->lengths = ALLOC(B->capacity * sizeof *B->lengths);
+                B->nulls = ALLOC(B->capacity);
+        }
+        B->columns = columns;
+        B->cells = 0;
+        B->used = 0;
+}
+
+
+/* Fetch a batch via the delegate's next and getString methods if fetchBatch is not supported */
+static int fetchBatch(T R, int maxRows) {
+        int rows = 0;
+        RowBuffer_T B = R->batch;
+        while (rows < maxRows && R->op->next(R->D)) {
+                for (int i = 1; i <= B->columns; i++) {
+                        const char *s = R->op->getString(R->D, i);
+                        RowBuffer_append(B, s, s ? R->op->getColumnSize(R->D, i) : 0);
+                }
+                rows++;
+        }
+        return rows;
+}
+
+
+static inline int getIndex(T R, const char *name) {
+        if (name) {
+                if (! R->names)
+                        buildIndex(R);
+                for (unsigned int h = hash(name) & R->mask; R->names[h]; h = (h + 1) & R->mask)
+                        if (Str_isByteEqual(name, ResultSet_getColumnName(R, R->names[h])))
+                                return R->names[h];
+        }
         THROW(SQLException, "Invalid column name '%s'", name ? name : "null");
         return -1;
 }
@@ -82,9 +174,45 @@ T ResultSet_new(ResultSetDelegate_T D, Rop_T op) {
 void ResultSet_free(T *R) {
 	assert(R && *R);
         (*R)->op->free(&(*R)->D);
+        FREE((*R)->names);
+        if ((*R)->batch) {
+                FREE((*R)->batch->data);
+                FREE((*R)->batch->offsets);
+                FREE((*R)->batch->lengths);
+                FREE((*R)->batch->nulls);
+                FREE((*R)->batch);
+        }
 	FREE(*R);
 }
 
+
+int ResultSet_getColumnType(T R, int columnIndex) {
+        assert(R);
+        return R->op->getColumnType ? R->op->getColumnType(R->D, columnIndex) : ColumnType_Text;
+}
+
+
+void RowBuffer_append(RowBuffer_T B, const void *value, long length) {
+        int cell = B->cells++;
+        assert(cell < B->capacity);
+        B->offsets[cell] = B->used;
+        B->lengths[cell] = value ? length : 0;
+        B->nulls[cell] = (value == NULL);
+        if (value) {
+                if (B->used + length + 1 > B->size) {
+                        while (B->used + length + 1 > B->size)
+                                B->size = B->size ? 2 * B->size : 1024;
+                        if (B->data)
+                                RESIZE(B->data, B->size);
+                        else
+                                B->data = ALLOC(B->size);
+                }
+                memcpy(B->data + B->used, value, length);
+                B->data[B->used + length] = 0;
+                B->used += length + 1;
+        }
+}
+
 #ifdef PACKAGE_PROTECTED
 #pragma GCC visibility pop
 #endif
@@ -111,11 +239,21 @@ long ResultSet_getColumnSize(T R, int columnIndex) {
 }
 
 
+long long int ResultSet_getStatus(T R, SQLStatus_T counter) {
+	assert(R);
+        assert(counter >= 0 && counter < SQL_STATUS_COUNT);
+	return R->op->getStatus ? R->op->getStatus(R->D, counter) : -1;
+}
+
+
 /* -------------------------------------------------------- Public methods */
 
 
 int ResultSet_next(T R) {
-        return R ? R->op->next(R->D) : false;
+        if (! R)
+                return false;
+        R->blobColumn = 0;
+        return R->op->next(R->D);
 }
 
 
@@ -131,8 +269,18 @@ const char *ResultSet_getStringByName(T R, const char *columnName) {
 }
 
 
+int ResultSet_isnull(T R, int columnIndex) {
+	assert(R);
+        if (R->op->isnull)
+                return R->op->isnull(R->D, columnIndex);
+        return (R->op->getString(R->D, columnIndex) == NULL);
+}
+
+
 int ResultSet_getInt(T R, int columnIndex) {
 	assert(R);
+        if (R->op->getInt)
+                return R->op->getInt(R->D, columnIndex);
         const char *s = R->op->getString(R->D, columnIndex);
 	return s ? Str_parseInt(s) : 0;
 }
@@ -146,6 +294,8 @@ int ResultSet_getIntByName(T R, const char *columnName) {
 
 long long int ResultSet_getLLong(T R, int columnIndex) {
 	assert(R);
+        if (R->op->getLLong)
+                return R->op->getLLong(R->D, columnIndex);
         const char *s = R->op->getString(R->D, columnIndex);
 	return s ? Str_parseLLong(s) : 0;
 }
@@ -159,6 +309,8 @@ long long int ResultSet_getLLongByName(T R, const char *columnName) {
 
 double ResultSet_getDouble(T R, int columnIndex) {
 	assert(R);
+        if (R->op->getDouble)
+                return R->op->getDouble(R->D, columnIndex);
         const char *s = R->op->getString(R->D, columnIndex);
 	return s ? Str_parseDouble(s) : 0.0;
 }
@@ -179,8 +331,37 @@ const void *ResultSet_getBlob(T R, int columnIndex, int *size) {
 }
 
 
+int ResultSet_readBlob(T R, int columnIndex, void *buffer, int size, int offset) {
+	assert(R);
+        assert(buffer);
+        assert(size >= 0);
+        assert(offset >= 0);
+        if (R->op->readBlob)
+                return R->op->readBlob(R->D, columnIndex, buffer, size, offset);
+        return readBlob(R, columnIndex, buffer, size, offset);
+}
+
+
 const void *ResultSet_getBlobByName(T R, const char *columnName, int *size) {
 	assert(R);
 	return ResultSet_getBlob(R, getIndex(R, columnName), size);
 }
 
+
+int ResultSet_fetchBatch(T R, int maxRows, RowBatch_T *batch) {
+        assert(R);
+        assert(maxRows > 0);
+        assert(batch);
+        resetBatch(R, maxRows);
+        R->blobColumn = 0;
+        // Do not step past the last row, SQLite would then execute the statement again
+        batch->rows = R->stop ? 0 : R->op->fetchBatch ? R->op->fetchBatch(R->D, maxRows, R->batch) : fetchBatch(R, maxRows);
+        R->stop = (batch->rows < maxRows);
+        batch->columns = R->batch->columns;
+        batch->data = R->batch->data;
+        batch->offsets = R->batch->offsets;
+        batch->lengths = R->batch->lengths;
+        batch->nulls = R->batch->nulls;
+        return batch->rows;
+}
+
@@ -86,6 +86,9 @@
  * ResultSet_getString() to get the number as a string or if we choose, we can use
  * ResultSet_getInt() to get the value as an integer. In the latter case, note
  * that if the column value cannot be converted to a number, an SQLException is thrown.
+ * Where the database client library provides numeric values in their native
+ * type, for instance SQLite and integer columns in MySQL, the numeric 
+ * get-methods read the value directly without a conversion to and from text.
  *
  * <i>A ResultSet is reentrant, but not thread-safe and should only be used by one thread (at the time).</i>
  *
@@ -94,6 +97,50 @@
  */
 
 
+/**
+ * Statement counters which can be used to find out why a query is slow. 
+ * The counters are obtained with ResultSet_getStatus() or 
+ * PreparedStatement_getStatus() and are currently only available with SQLite.
+ */
+typedef enum {
+        /** Number of times the database stepped forward in a table as part of a full table scan */
+        SQL_STATUS_FULLSCAN_STEP = 0,
+        /** Number of sort operations */
+        SQL_STATUS_SORT,
+        /** Number of rows inserted into transient indices created automatically */
+        SQL_STATUS_AUTOINDEX,
+        /** Number of virtual machine operations executed */
+        SQL_STATUS_VM_STEP
+} SQLStatus_T;
+
+/** Number of statement counters in SQLStatus_T */
+#define SQL_STATUS_COUNT 4
+
+
+/**
+ * A batch of rows fetched with ResultSet_fetchBatch(). Values are stored
+ * one after the other in a contiguous arena, <code>data</code>, row by 
+ * row. The value of column <code>c</code> (starting at 0) in row 
+ * <code>r</code> is found at cell <code>r * columns + c</code> of the
+ * offsets, lengths and nulls arrays. Each value is NUL terminated in the
+ * arena so text values can be used directly as C-strings.
+ */
+typedef struct RowBatch_S {
+        /** Number of rows in the batch */
+        int rows;
+        /** Number of columns in each row */
+        int columns;
+        /** The arena with all values in the batch */
+        const char *data;
+        /** Offset of each value in data */
+        const long *offsets;
+        /** Length of each value in bytes */
+        const long *lengths;
+        /** true if the value is SQL NULL, the length is then 0 */
+        const char *nulls;
+} RowBatch_T;
+
+
 #define T ResultSet_T
 typedef struct ResultSet_S *T;
 
@@ -114,6 +161,17 @@ T ResultSet_new(ResultSetDelegate_T D, Rop_T op);
  */
 void ResultSet_free(T *R);
 
+
+/**
+ * Returns the type of the designated column, used to export values in
+ * their native type. Backends which do not report column types return
+ * ColumnType_Text.
+ * @param R A ResultSet object
+ * @param columnIndex The first column is 1, the second is 2, ...
+ * @return The ColumnType_T of the column
+ */
+int ResultSet_getColumnType(T R, int columnIndex);
+
 //>> End Protected methods
 
 /** @name Properties */
@@ -152,6 +210,18 @@ const char *ResultSet_getColumnName(T R, int columnIndex);
  */
 long ResultSet_getColumnSize(T R, int columnIndex);
 
+
+/**
+ * Returns the value of a statement counter for the statement which 
+ * produced this ResultSet. The counter is for the current execution of 
+ * the statement. 
+ * @param R A ResultSet object
+ * @param counter The counter to return
+ * @return The counter value or -1 if the counter is not available
+ * for this database
+ */
+long long int ResultSet_getStatus(T R, SQLStatus_T counter);
+
 //@}
 
 /**
@@ -204,6 +274,22 @@ const char *ResultSet_getString(T R, int columnIndex);
 const char *ResultSet_getStringByName(T R, const char *columnName);
 
 
+/**
+ * Returns true if the value of the designated column in the current row 
+ * of this ResultSet object is SQL NULL. Use this method to tell a NULL
+ * apart from 0 returned by the numeric get-methods. If 
+ * <code>columnIndex</code> is outside the range 
+ * [1..ResultSet_getColumnCount()] this method throws an SQLException.
+ * @param R A ResultSet object
+ * @param columnIndex The first column is 1, the second is 2, ...
+ * @return true if the column value is SQL NULL, otherwise false
+ * @exception SQLException if a database access error occurs or 
+ * columnIndex is outside the valid range
+ * @see SQLException.h
+ */
+int ResultSet_isnull(T R, int columnIndex);
+
+
 /**
  * Retrieves the value of the designated column in the current row of
  * this ResultSet object as an int. If <code>columnIndex</code>
@@ -334,5 +420,63 @@ const void *ResultSet_getBlob(T R, int columnIndex, int *size);
 const void *ResultSet_getBlobByName(T R, const char *columnName, int *size);
 
 
+/**
+ * Reads up to <code>size</code> bytes of the blob value of the designated
+ * column in the current row, starting at <code>offset</code>, into 
+ * <code>buffer</code>. A large value can be read in chunks of a fixed size,
+ * for instance to be written to a socket, instead of being retrieved as a
+ * whole with ResultSet_getBlob(). With MySQL and Oracle only the requested
+ * part of the value is copied, or read from the server for an Oracle LOB,
+ * other databases copy the part from the value already in the row. 
+ * Example:
+ * <pre>
+ * for (int offset = 0, n; (n = ResultSet_readBlob(r, 1, chunk, sizeof(chunk), offset)) > 0; offset += n)
+ *        write(socket, chunk, n);
+ * </pre>
+ * @param R A ResultSet object
+ * @param columnIndex The first column is 1, the second is 2, ...
+ * @param buffer The buffer to read into
+ * @param size The number of bytes to read at most
+ * @param offset The offset in the value to read from
+ * @return The number of bytes read; 0 if offset is at or past the end
+ * of the value or if the value is SQL NULL
+ * @exception SQLException if a database access error occurs or 
+ * columnIndex is outside the valid range
+ * @see SQLException.h
+ */
+int ResultSet_readBlob(T R, int columnIndex, void *buffer, int size, int offset);
+
+
+/**
+ * Fetch up to <code>maxRows</code> rows from this ResultSet into 
+ * <code>batch</code>. This is a faster alternative to calling 
+ * ResultSet_next() and a get-method for every column when all values of
+ * many rows are read, for instance to export a table. Values are the 
+ * same as those returned by ResultSet_getString() with the length given
+ * by ResultSet_getColumnSize(), so binary values are returned as-is where
+ * the database does this for ResultSet_getString(). The ResultSet cursor
+ * is moved past the fetched rows. <i>The values in the batch are only 
+ * valid until the next call to ResultSet_fetchBatch() or ResultSet_next()
+ * and if you plan to use them longer, you must make a copy.</i> Example:
+ * <pre>
+ * RowBatch_T batch;
+ * ResultSet_T r = Connection_executeQuery(con, "SELECT id, name FROM employees");
+ * while (ResultSet_fetchBatch(r, 100, &batch)) {
+ *         for (int i = 0; i < batch.rows; i++) {
+ *                 int name = i * batch.columns + 1;
+ *                 printf("%s\n", batch.nulls[name] ? "null" : batch.data + batch.offsets[name]);
+ *         }
+ * }
+ * </pre>
+ * @param R A ResultSet object
+ * @param maxRows The maximum number of rows to fetch, must be > 0
+ * @param batch The batch to fill with the rows fetched
+ * @return The number of rows fetched; 0 if there are no more rows
+ * @exception SQLException if a database access error occurs
+ * @see SQLException.h
+ */
+int ResultSet_fetchBatch(T R, int maxRows, RowBatch_T *batch);
+
+
 #undef T
 #endif
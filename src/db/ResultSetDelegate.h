@@ -37,6 +37,28 @@
 #define T ResultSetDelegate_T
 typedef struct T *T;
 
+/* Column types returned by getColumnType */
+typedef enum {
+        ColumnType_Text = 0,
+        ColumnType_Integer,
+        ColumnType_Real,
+        ColumnType_Blob
+} ColumnType_T;
+
+/* Arena for a batch of rows, see ResultSet_fetchBatch(). The offsets, lengths and nulls
+ arrays have room for maxRows * columns cells when passed to the fetchBatch method */
+typedef struct RowBuffer_S {
+        int cells;
+        int columns;
+        int capacity;
+        long used;
+        long size;
+        char *data;
+        long *offsets;
+        long *lengths;
+        char *nulls;
+} *RowBuffer_T;
+
 typedef struct Rop_T {
         const char *name;
         void (*free)(T *R);
@@ -46,7 +68,20 @@ typedef struct Rop_T {
         long (*getColumnSize)(T R, int columnIndex);
         const char *(*getString)(T R, int columnIndex);
         const void *(*getBlob)(T R, int columnIndex, int *size);
+        // Optional methods, NULL if not supported
+        long long int (*getStatus)(T R, int counter);
+        int (*isnull)(T R, int columnIndex);
+        int (*getInt)(T R, int columnIndex);
+        long long int (*getLLong)(T R, int columnIndex);
+        double (*getDouble)(T R, int columnIndex);
+        int (*fetchBatch)(T R, int maxRows, RowBuffer_T B);
+        int (*getColumnType)(T R, int columnIndex);
+        int (*readBlob)(T R, int columnIndex, void *buffer, int size, int offset);
 } *Rop_T;
 
+
+/* Append the next value to the row buffer. A NULL value is SQL NULL */
+void RowBuffer_append(RowBuffer_T B, const void *value, long length);
+
 #undef T
 #endif
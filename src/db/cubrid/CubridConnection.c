@@ -8,6 +8,7 @@
 #include "ResultSet.h"
 #include "StringBuffer.h"
 #include "PreparedStatement.h"
+#include "Blob.h"
 #include "CubridResultSet.h"
 #include "CubridPreparedStatement.h"
 #include "ConnectionDelegate.h"
@@ -48,7 +49,10 @@ const struct Cop_T cubridcops = {
         CubridConnection_execute,
         CubridConnection_executeQuery,
         CubridConnection_prepareStatement,
-        CubridConnection_getLastError
+        CubridConnection_getLastError,
+        NULL,
+        NULL,
+        NULL
 };
 
 struct T {
@@ -34,7 +34,9 @@
 #include "ResultSet.h"
 #include "StringBuffer.h"
 #include "PreparedStatement.h"
+#include "Blob.h"
 #include "MysqlResultSet.h"
+#include "MysqlTextResultSet.h"
 #include "MysqlPreparedStatement.h"
 #include "ConnectionDelegate.h"
 #include "MysqlConnection.h"
@@ -69,7 +71,10 @@ const struct Cop_T mysqlcops = {
         MysqlConnection_execute,
         MysqlConnection_executeQuery,
         MysqlConnection_prepareStatement,
-        MysqlConnection_getLastError
+        MysqlConnection_getLastError,
+        NULL,
+        NULL,
+        NULL
 };
 
 #define T ConnectionDelegate_T
@@ -79,11 +84,15 @@ struct T {
 	int maxRows;
 	int timeout;
 	int lastError;
+        int resultMode;
+        unsigned long prefetchRows;
+        struct MysqlStream_S stream;
         StringBuffer_T sb;
 };
 #define MYSQL_OK 0
 
 extern const struct Rop_T mysqlrops;
+extern const struct Rop_T mysqltextrops;
 extern const struct Pop_T mysqlpops;
 
 
@@ -148,6 +157,32 @@ error:
 }
 
 
+static int getResultMode(URL_T url, int *resultMode, unsigned long *prefetchRows, char **error) {
+        const char *mode = URL_getParameter(url, "result-mode");
+        const char *prefetch = URL_getParameter(url, "prefetch-rows");
+        if (! mode || IS(mode, "cursor"))
+                *resultMode = MYSQL_RESULT_CURSOR;
+        else if (IS(mode, "buffered"))
+                *resultMode = MYSQL_RESULT_BUFFERED;
+        else if (IS(mode, "stream"))
+                *resultMode = MYSQL_RESULT_STREAM;
+        else {
+                *error = Str_cat("invalid result-mode value '%s'", mode);
+                return false;
+        }
+        if (prefetch) {
+                volatile int rows = 0;
+                TRY rows = Str_parseInt(prefetch); ELSE END_TRY;
+                if (rows <= 0) {
+                        *error = Str_cat("invalid prefetch-rows value '%s'", prefetch);
+                        return false;
+                }
+                *prefetchRows = rows;
+        }
+        return true;
+}
+
+
 static int prepare(T C, const char *sql, int len, MYSQL_STMT **stmt) {
         if (! (*stmt = mysql_stmt_init(C->db))) {
                 DEBUG("mysql_stmt_init -- Out of memory\n");
@@ -161,6 +196,10 @@ static int prepare(T C, const char *sql, int len, MYSQL_STMT **stmt) {
                 *stmt = NULL;
                 return false;
         }
+#if MYSQL_VERSION_ID >= 50006
+        if (C->prefetchRows)
+                mysql_stmt_attr_set(*stmt, STMT_ATTR_PREFETCH_ROWS, &C->prefetchRows);
+#endif
         return true;
 }
 
@@ -175,12 +214,18 @@ static int prepare(T C, const char *sql, int len, MYSQL_STMT **stmt) {
 T MysqlConnection_new(URL_T url, char **error) {
 	T C;
         MYSQL *db;
+        int resultMode;
+        unsigned long prefetchRows = 0;
 	assert(url);
         assert(error);
+        if (! getResultMode(url, &resultMode, &prefetchRows, error))
+                return NULL;
         if (! (db = doConnect(url, error)))
                 return NULL;
 	NEW(C);
         C->db = db;
+        C->resultMode = resultMode;
+        C->prefetchRows = prefetchRows;
         C->url = url;
         C->sb = StringBuffer_create(STRLEN);
         C->timeout = SQL_DEFAULT_TIMEOUT;
@@ -222,12 +267,14 @@ void MysqlConnection_setMaxRows(T C, int max) {
 
 int MysqlConnection_ping(T C) {
         assert(C);
+        MysqlStream_drain(&C->stream);
         return (mysql_ping(C->db) == 0);
 }
 
 
 int MysqlConnection_beginTransaction(T C) {
 	assert(C);
+        MysqlStream_drain(&C->stream);
         C->lastError = mysql_query(C->db, "START TRANSACTION;");
         return (C->lastError == MYSQL_OK);
 }
@@ -235,6 +282,7 @@ int MysqlConnection_beginTransaction(T C) {
 
 int MysqlConnection_commit(T C) {
 	assert(C);
+        MysqlStream_drain(&C->stream);
         C->lastError = mysql_query(C->db, "COMMIT;");
         return (C->lastError == MYSQL_OK);
 }
@@ -242,6 +290,7 @@ int MysqlConnection_commit(T C) {
 
 int MysqlConnection_rollback(T C) {
 	assert(C);
+        MysqlStream_drain(&C->stream);
         C->lastError = mysql_query(C->db, "ROLLBACK;");
         return (C->lastError == MYSQL_OK);
 }
@@ -266,31 +315,47 @@ int MysqlConnection_execute(T C, const char *sql, va_list ap) {
         va_copy(ap_copy, ap);
         StringBuffer_vappend(C->sb, sql, ap_copy);
         va_end(ap_copy);
+        MysqlStream_drain(&C->stream);
         C->lastError = mysql_real_query(C->db, StringBuffer_toString(C->sb), StringBuffer_length(C->sb));
 	return (C->lastError == MYSQL_OK);
 }
 
 
+/* In the default cursor mode the query is fetched through a read-only server
+ side cursor of a statement which is closed with the result set. In buffered
+ and stream mode the query uses the text protocol and is sent in one round
+ trip; in stream mode rows are read from the server as the result set is
+ iterated, otherwise the result is read at once. See the URL option
+ result-mode */
 ResultSet_T MysqlConnection_executeQuery(T C, const char *sql, va_list ap) {
         va_list ap_copy;
-        MYSQL_STMT *stmt = NULL;
 	assert(C);
         StringBuffer_clear(C->sb);
         va_copy(ap_copy, ap);
         StringBuffer_vappend(C->sb, sql, ap_copy);
         va_end(ap_copy);
-        if (prepare(C, StringBuffer_toString(C->sb), StringBuffer_length(C->sb), &stmt)) {
+        MysqlStream_drain(&C->stream);
+        if (C->resultMode == MYSQL_RESULT_CURSOR) {
+                MYSQL_STMT *stmt = NULL;
+                if (prepare(C, StringBuffer_toString(C->sb), StringBuffer_length(C->sb), &stmt)) {
 #if MYSQL_VERSION_ID >= 50002
-                unsigned long cursor = CURSOR_TYPE_READ_ONLY;
-                mysql_stmt_attr_set(stmt, STMT_ATTR_CURSOR_TYPE, &cursor);
+                        unsigned long cursor = CURSOR_TYPE_READ_ONLY;
+                        mysql_stmt_attr_set(stmt, STMT_ATTR_CURSOR_TYPE, &cursor);
 #endif
-                if ((C->lastError = mysql_stmt_execute(stmt))) {
-                        StringBuffer_clear(C->sb);
-                        StringBuffer_append(C->sb, "%s", mysql_stmt_error(stmt));
-                        mysql_stmt_close(stmt);
+                        if ((C->lastError = mysql_stmt_execute(stmt))) {
+                                StringBuffer_clear(C->sb);
+                                StringBuffer_append(C->sb, "%s", mysql_stmt_error(stmt));
+                                mysql_stmt_close(stmt);
+                        }
+                        else
+                                return ResultSet_new(MysqlResultSet_new(stmt, C->maxRows, false, NULL), (Rop_T)&mysqlrops);
                 }
-                else
-                        return ResultSet_new(MysqlResultSet_new(stmt, C->maxRows, false), (Rop_T)&mysqlrops);
+        } else if ((C->lastError = mysql_real_query(C->db, StringBuffer_toString(C->sb), StringBuffer_length(C->sb))) == MYSQL_OK) {
+                int stream = (C->resultMode == MYSQL_RESULT_STREAM);
+                MYSQL_RES *res = stream ? mysql_use_result(C->db) : mysql_store_result(C->db);
+                if (res || mysql_field_count(C->db) == 0)
+                        return ResultSet_new(MysqlTextResultSet_new(C->db, res, C->maxRows, stream ? &C->stream : NULL), (Rop_T)&mysqltextrops);
+                C->lastError = mysql_errno(C->db);
         }
         return NULL;
 }
@@ -304,8 +369,9 @@ PreparedStatement_T MysqlConnection_prepareStatement(T C, const char *sql, va_li
         va_copy(ap_copy, ap);
         StringBuffer_vappend(C->sb, sql, ap_copy);
         va_end(ap_copy);
+        MysqlStream_drain(&C->stream);
         if (prepare(C, StringBuffer_toString(C->sb), StringBuffer_length(C->sb), &stmt))
-		return PreparedStatement_new(MysqlPreparedStatement_new(stmt, C->maxRows), (Pop_T)&mysqlpops);
+		return PreparedStatement_new(MysqlPreparedStatement_new(stmt, C->maxRows, C->resultMode, &C->stream), (Pop_T)&mysqlpops);
         return NULL;
 }
 
@@ -56,7 +56,9 @@ const struct Pop_T mysqlpops = {
         MysqlPreparedStatement_setDouble,
         MysqlPreparedStatement_setBlob,
         MysqlPreparedStatement_execute,
-        MysqlPreparedStatement_executeQuery
+        MysqlPreparedStatement_executeQuery,
+        NULL,
+        MysqlPreparedStatement_setBlobStream
 };
 
 typedef struct param_t {
@@ -66,20 +68,30 @@ typedef struct param_t {
                 double real;
         } type;
         long length;
+        long (*read)(void *buffer, long length, void *ap);
+        void *ap;
+        int consumed;
 } *param_t;
 
 #define T PreparedStatementDelegate_T
 struct T {
         int maxRows;
         int lastError;
+        int resultMode;
+        int rebind;
+        int longData;
         int paramCount;
         param_t params;
         MYSQL_STMT *stmt;
         MYSQL_BIND *bind;
+        MysqlStream_T stream;
 };
 
 static my_bool yes = true;
 
+/* Chunk size used to send a streamed parameter */
+#define MYSQL_LONG_DATA_CHUNK 16384
+
 #define TEST_INDEX \
         int i; assert(P); i = parameterIndex - 1; if (P->paramCount <= 0 || \
         i < 0 || i >= P->paramCount) THROW(SQLException, "Parameter index is out of range"); 
@@ -87,6 +99,67 @@ static my_bool yes = true;
 extern const struct Rop_T mysqlrops;
 
 
+/* ------------------------------------------------------- Private methods */
+
+
+/* Values are read from the bound buffers when the statement is executed, so
+ the parameters only have to be bound again if a buffer, its type or its null
+ indicator changed. See also MysqlPreparedStatement_new() for length */
+static inline void bind(T P, int i, enum enum_field_types type, void *buffer, my_bool *is_null) {
+        MYSQL_BIND *b = &P->bind[i];
+        P->params[i].read = NULL;
+        P->params[i].consumed = false;
+        if (b->buffer_type != type || b->buffer != buffer || b->is_null != is_null) {
+                b->buffer_type = type;
+                b->buffer = buffer;
+                b->is_null = is_null;
+                P->rebind = true;
+        }
+}
+
+
+static inline void bindParams(T P) {
+        if (P->rebind) {
+                if ((P->lastError = mysql_stmt_bind_param(P->stmt, P->bind)))
+                        THROW(SQLException, "%s", mysql_stmt_error(P->stmt));
+                P->rebind = false;
+        }
+}
+
+
+/* Send streamed parameters in chunks with mysql_stmt_send_long_data. The
+ server collects the chunks and uses them instead of the bound buffer when
+ the statement is executed */
+static void sendLongData(T P) {
+        char chunk[MYSQL_LONG_DATA_CHUNK];
+        for (int i = 0; i < P->paramCount; i++) {
+                if (P->params[i].read) {
+                        long n, (*read)(void *buffer, long length, void *ap) = P->params[i].read;
+                        // The stream is consumed, it must be set again before the next execute
+                        P->params[i].read = NULL;
+                        P->params[i].consumed = true;
+                        P->longData = true;
+                        while ((n = read(chunk, MYSQL_LONG_DATA_CHUNK, P->params[i].ap)) > 0) {
+                                if ((P->lastError = mysql_stmt_send_long_data(P->stmt, i, chunk, n))) {
+                                        char error[STRLEN];
+                                        snprintf(error, STRLEN, "%s", mysql_stmt_error(P->stmt));
+                                        mysql_stmt_reset(P->stmt); // Discard the chunks sent and clear the error
+                                        P->longData = false;
+                                        THROW(SQLException, "%s", error);
+                                }
+                        }
+                        if (n < 0) {
+                                mysql_stmt_reset(P->stmt);
+                                P->longData = false;
+                                THROW(SQLException, "Error reading blob stream");
+                        }
+                } else if (P->params[i].consumed) {
+                        THROW(SQLException, "Blob stream parameter %d was consumed by the previous execute, set it again", i + 1);
+                }
+        }
+}
+
+
 /* ----------------------------------------------------- Protected methods */
 
 
@@ -94,16 +167,22 @@ extern const struct Rop_T mysqlrops;
 #pragma GCC visibility push(hidden)
 #endif
 
-T MysqlPreparedStatement_new(void *stmt, int maxRows) {
+T MysqlPreparedStatement_new(void *stmt, int maxRows, int resultMode, MysqlStream_T stream) {
         T P;
         assert(stmt);
         NEW(P);
         P->stmt = stmt;
+        P->stream = stream;
         P->maxRows = maxRows;
+        P->resultMode = resultMode;
         P->paramCount = (int)mysql_stmt_param_count(P->stmt);
         if (P->paramCount>0) {
                 P->params = CALLOC(P->paramCount, sizeof(struct param_t));
                 P->bind = CALLOC(P->paramCount, sizeof(MYSQL_BIND));
+                // The length is only used for strings and blobs and never changes
+                for (int i = 0; i < P->paramCount; i++)
+                        P->bind[i].length = &P->params[i].length;
+                P->rebind = true;
         }
         P->lastError = MYSQL_OK;
         return P;
@@ -127,90 +206,85 @@ void MysqlPreparedStatement_free(T *P) {
 
 void MysqlPreparedStatement_setString(T P, int parameterIndex, const char *x) {
         TEST_INDEX
-        P->bind[i].buffer_type = MYSQL_TYPE_STRING;
-        P->bind[i].buffer = (char*)x;
-        if (! x) {
-                P->params[i].length = 0;
-                P->bind[i].is_null = &yes;
-        } else {
-                P->params[i].length = strlen(x);
-                P->bind[i].is_null = 0;
-        }
-        P->bind[i].length = &P->params[i].length;
+        P->params[i].length = x ? strlen(x) : 0;
+        bind(P, i, MYSQL_TYPE_STRING, (char*)x, x ? NULL : &yes);
 }
 
 
 void MysqlPreparedStatement_setInt(T P, int parameterIndex, int x) {
         TEST_INDEX
         P->params[i].type.integer = x;
-        P->bind[i].buffer_type = MYSQL_TYPE_LONG;
-        P->bind[i].buffer = (char*)&P->params[i].type.integer;
-        P->bind[i].is_null = 0;
+        bind(P, i, MYSQL_TYPE_LONG, &P->params[i].type.integer, NULL);
 }
 
 
 void MysqlPreparedStatement_setLLong(T P, int parameterIndex, long long int x) {
         TEST_INDEX
         P->params[i].type.llong = x;
-        P->bind[i].buffer_type = MYSQL_TYPE_LONGLONG;
-        P->bind[i].buffer = (char*)&P->params[i].type.llong;
-        P->bind[i].is_null = 0;
+        bind(P, i, MYSQL_TYPE_LONGLONG, &P->params[i].type.llong, NULL);
 }
 
 
 void MysqlPreparedStatement_setDouble(T P, int parameterIndex, double x) {
         TEST_INDEX
         P->params[i].type.real = x;
-        P->bind[i].buffer_type = MYSQL_TYPE_DOUBLE;
-        P->bind[i].buffer = (char*)&P->params[i].type.real;
-        P->bind[i].is_null = 0;
+        bind(P, i, MYSQL_TYPE_DOUBLE, &P->params[i].type.real, NULL);
 }
 
 
 void MysqlPreparedStatement_setBlob(T P, int parameterIndex, const void *x, int size) {
         TEST_INDEX
-        P->bind[i].buffer_type = MYSQL_TYPE_BLOB;
-        P->bind[i].buffer = (void*)x;
-        if (! x) {
-                P->params[i].length = 0;
-                P->bind[i].is_null = &yes;
-        } else {
-                P->params[i].length = size;
-                P->bind[i].is_null = 0;
-        }
-        P->bind[i].length = &P->params[i].length;
+        P->params[i].length = x ? size : 0;
+        bind(P, i, MYSQL_TYPE_BLOB, (void*)x, x ? NULL : &yes);
+}
+
+
+void MysqlPreparedStatement_setBlobStream(T P, int parameterIndex, long read(void *buffer, long length, void *ap), void *ap) {
+        TEST_INDEX
+        P->params[i].length = 0;
+        bind(P, i, MYSQL_TYPE_BLOB, NULL, NULL);
+        P->params[i].read = read;
+        P->params[i].ap = ap;
 }
 
 
 void MysqlPreparedStatement_execute(T P) {
         assert(P);
-        if ((P->paramCount > 0) && (P->lastError = mysql_stmt_bind_param(P->stmt, P->bind)))
-                        THROW(SQLException, "%s", mysql_stmt_error(P->stmt));
+        MysqlStream_drain(P->stream);
+        bindParams(P);
+        sendLongData(P);
 #if MYSQL_VERSION_ID >= 50002
         unsigned long cursor = CURSOR_TYPE_NO_CURSOR;
         mysql_stmt_attr_set(P->stmt, STMT_ATTR_CURSOR_TYPE, &cursor);
 #endif
         if ((P->lastError = mysql_stmt_execute(P->stmt))) 
                 THROW(SQLException, "%s", mysql_stmt_error(P->stmt));
-        if (P->lastError == MYSQL_OK) {
-                /* Discard prepared param data in client/server */
+        /* A reset is only needed to discard long data or the rows of a statement
+         which returned a result set. Otherwise execute is one round trip */
+        if (P->longData || mysql_stmt_field_count(P->stmt) > 0) {
                 P->lastError = mysql_stmt_reset(P->stmt);
+                P->longData = false;
         }
 }
 
 
 ResultSet_T MysqlPreparedStatement_executeQuery(T P) {
         assert(P);
-        if ((P->paramCount > 0) && (P->lastError = mysql_stmt_bind_param(P->stmt, P->bind)))
-                        THROW(SQLException, "%s", mysql_stmt_error(P->stmt));
+        MysqlStream_drain(P->stream);
+        bindParams(P);
+        sendLongData(P);
 #if MYSQL_VERSION_ID >= 50002
-        unsigned long cursor = CURSOR_TYPE_READ_ONLY;
+        unsigned long cursor = (P->resultMode == MYSQL_RESULT_CURSOR) ? CURSOR_TYPE_READ_ONLY : CURSOR_TYPE_NO_CURSOR;
         mysql_stmt_attr_set(P->stmt, STMT_ATTR_CURSOR_TYPE, &cursor);
 #endif
+        my_bool updateMaxLength = (P->resultMode == MYSQL_RESULT_BUFFERED);
+        mysql_stmt_attr_set(P->stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &updateMaxLength);
         if ((P->lastError = mysql_stmt_execute(P->stmt))) 
                 THROW(SQLException, "%s", mysql_stmt_error(P->stmt));
+        if (P->resultMode == MYSQL_RESULT_BUFFERED && (P->lastError = mysql_stmt_store_result(P->stmt)))
+                THROW(SQLException, "%s", mysql_stmt_error(P->stmt));
         if (P->lastError == MYSQL_OK)
-                return ResultSet_new(MysqlResultSet_new(P->stmt, P->maxRows, true), (Rop_T)&mysqlrops);
+                return ResultSet_new(MysqlResultSet_new(P->stmt, P->maxRows, true, (P->resultMode == MYSQL_RESULT_STREAM) ? P->stream : NULL), (Rop_T)&mysqlrops);
         THROW(SQLException, "%s", mysql_stmt_error(P->stmt));
         return NULL;
 }
@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #include <mysql.h>
 #include <errmsg.h>
 
@@ -47,6 +48,9 @@
 
 #define MYSQL_OK 0
 
+/* Columns declared longer than this start with a STRLEN buffer which grows as needed */
+#define MYSQL_BUFFER_MAX 16384
+
 const struct Rop_T mysqlrops = {
 	"mysql",
         MysqlResultSet_free,
@@ -56,12 +60,22 @@ const struct Rop_T mysqlrops = {
         MysqlResultSet_getColumnSize,
         MysqlResultSet_getString,
         MysqlResultSet_getBlob,
+        NULL,
+        MysqlResultSet_isnull,
+        MysqlResultSet_getInt,
+        MysqlResultSet_getLLong,
+        MysqlResultSet_getDouble,
+        NULL,
+        MysqlResultSet_getColumnType,
+        MysqlResultSet_readBlob
 };
 
 typedef struct column_t {
         my_bool is_null;
+        int isInteger;
         MYSQL_FIELD *field;
         unsigned long real_length;
+        long long int integer;
         char *buffer;
 } *column_t;
 
@@ -78,6 +92,7 @@ struct T {
         MYSQL_BIND *bind;
 	MYSQL_STMT *stmt;
         column_t columns;
+        MysqlStream_T stream;
 };
 
 #define TEST_INDEX \
@@ -88,12 +103,51 @@ struct T {
 /* ------------------------------------------------------- Private methods */
 
 
+/* Integer columns which can be fetched as MYSQL_TYPE_LONGLONG without loss. Zerofill
+ columns are fetched as text to keep the padding */
+static inline int isInteger(MYSQL_FIELD *field) {
+        if (field->flags & ZEROFILL_FLAG)
+                return false;
+        switch (field->type) {
+                case MYSQL_TYPE_TINY:
+                case MYSQL_TYPE_SHORT:
+                case MYSQL_TYPE_INT24:
+                case MYSQL_TYPE_LONG: return true;
+                case MYSQL_TYPE_LONGLONG: return ! (field->flags & UNSIGNED_FLAG);
+                default: return false;
+        }
+}
+
+
+/* Format an integer column as text in the column buffer. Returns the text length */
+static inline int formatInteger(T R, int i) {
+        return snprintf(R->columns[i].buffer, STRLEN, "%lld", R->columns[i].integer);
+}
+
+
+/* Initial buffer size for a column. The longest value is known for a buffered result,
+ otherwise the declared length is used unless the column is a large text or blob */
+static inline unsigned long getBufferSize(MYSQL_FIELD *field) {
+        if (field->max_length)
+                return field->max_length;
+        if (field->length && field->length <= MYSQL_BUFFER_MAX)
+                return field->length;
+        return STRLEN;
+}
+
+
 static inline void ensureCapacity(T R, int i) {
+        if (R->columns[i].isInteger)
+                return;
         if ((R->columns[i].real_length > R->bind[i].buffer_length)) {
-                /* Column was truncated, resize and fetch column directly. */
-                RESIZE(R->columns[i].buffer, R->columns[i].real_length + 1);
+                /* Column was truncated, resize and fetch column directly. The buffer is at
+                 least doubled so a column with growing values is not re-fetched on every row */
+                unsigned long size = 2 * R->bind[i].buffer_length;
+                if (size < R->columns[i].real_length)
+                        size = R->columns[i].real_length;
+                RESIZE(R->columns[i].buffer, size + 1);
                 R->bind[i].buffer = R->columns[i].buffer;
-                R->bind[i].buffer_length = R->columns[i].real_length;
+                R->bind[i].buffer_length = size;
                 if ((R->lastError = mysql_stmt_fetch_column(R->stmt, &R->bind[i], i, 0)))
                         THROW(SQLException, "mysql_stmt_fetch_column -- %s", mysql_stmt_error(R->stmt));
                 R->needRebind = true;
@@ -101,6 +155,21 @@ static inline void ensureCapacity(T R, int i) {
 }
 
 
+static void endStream(T R) {
+        if (R->stream && R->stream->R == R)
+                R->stream->R = NULL;
+}
+
+
+/* Discard the rows of a streamed result not read so the connection can run another command */
+static void drain(void *R) {
+        T r = R;
+        mysql_stmt_free_result(r->stmt);
+        r->stop = true;
+        endStream(r);
+}
+
+
 /* ----------------------------------------------------- Protected methods */
 
 
@@ -108,7 +177,8 @@ static inline void ensureCapacity(T R, int i) {
 #pragma GCC visibility push(hidden)
 #endif
 
-T MysqlResultSet_new(void *stmt, int maxRows, int keep) {
+/* If stream is given the result is streamed and registered as the connection's pending stream */
+T MysqlResultSet_new(void *stmt, int maxRows, int keep, MysqlStream_T stream) {
 	T R;
 	assert(stmt);
 	NEW(R);
@@ -123,25 +193,40 @@ T MysqlResultSet_new(void *stmt, int maxRows, int keep) {
                 R->bind = CALLOC(R->columnCount, sizeof (MYSQL_BIND));
                 R->columns = CALLOC(R->columnCount, sizeof (struct column_t));
                 for (int i = 0; i < R->columnCount; i++) {
-                        R->columns[i].buffer = ALLOC(STRLEN + 1);
+                        R->columns[i].field = mysql_fetch_field_direct(R->meta, i);
+                        unsigned long size = getBufferSize(R->columns[i].field);
+                        if (size < STRLEN)
+                                size = STRLEN;
+                        R->columns[i].buffer = ALLOC(size + 1);
                         R->bind[i].buffer_type = MYSQL_TYPE_STRING;
                         R->bind[i].buffer = R->columns[i].buffer;
-                        R->bind[i].buffer_length = STRLEN;
+                        R->bind[i].buffer_length = size;
                         R->bind[i].is_null = &R->columns[i].is_null;
                         R->bind[i].length = &R->columns[i].real_length;
-                        R->columns[i].field = mysql_fetch_field_direct(R->meta, i);
+                        if ((R->columns[i].isInteger = isInteger(R->columns[i].field))) {
+                                R->bind[i].buffer_type = MYSQL_TYPE_LONGLONG;
+                                R->bind[i].buffer = &R->columns[i].integer;
+                                R->bind[i].buffer_length = sizeof(long long int);
+                                R->bind[i].is_unsigned = (R->columns[i].field->flags & UNSIGNED_FLAG) ? 1 : 0;
+                        }
                 }
                 if ((R->lastError = mysql_stmt_bind_result(R->stmt, R->bind))) {
                         DEBUG("Warning: bind error - %s\n", mysql_stmt_error(stmt));
                         R->stop = true;
                 }
         }
+        if (stream && ! R->stop) {
+                R->stream = stream;
+                stream->R = R;
+                stream->drain = drain;
+        }
 	return R;
 }
 
 
 void MysqlResultSet_free(T *R) {
 	assert(R && *R);
+        endStream(*R);
         for (int i = 0; i < (*R)->columnCount; i++)
                 FREE((*R)->columns[i].buffer);
         mysql_stmt_free_result((*R)->stmt);
@@ -196,6 +281,8 @@ int MysqlResultSet_next(T R) {
         R->lastError = mysql_stmt_fetch(R->stmt);
         if (R->lastError == 1)
                 THROW(SQLException, "mysql_stmt_fetch -- %s", mysql_stmt_error(R->stmt));
+        if (R->lastError == MYSQL_NO_DATA)
+                endStream(R);
         return ((R->lastError == MYSQL_OK) || (R->lastError == MYSQL_DATA_TRUNCATED));
 }
 
@@ -204,6 +291,8 @@ long MysqlResultSet_getColumnSize(T R, int columnIndex) {
         TEST_INDEX
         if (R->columns[i].is_null) 
                 return 0;
+        if (R->columns[i].isInteger)
+                return formatInteger(R, i);
         return R->columns[i].real_length;
 }
 
@@ -212,6 +301,10 @@ const char *MysqlResultSet_getString(T R, int columnIndex) {
         TEST_INDEX
         if (R->columns[i].is_null) 
                 return NULL;
+        if (R->columns[i].isInteger) {
+                formatInteger(R, i);
+                return R->columns[i].buffer;
+        }
         ensureCapacity(R, i);
         R->columns[i].buffer[R->columns[i].real_length] = 0;
         return R->columns[i].buffer;
@@ -222,11 +315,94 @@ const void *MysqlResultSet_getBlob(T R, int columnIndex, int *size) {
         TEST_INDEX
         if (R->columns[i].is_null) 
                 return NULL;
+        if (R->columns[i].isInteger) {
+                *size = formatInteger(R, i);
+                return R->columns[i].buffer;
+        }
         ensureCapacity(R, i);
         *size = (int)R->columns[i].real_length;
         return R->columns[i].buffer;
 }
 
+
+int MysqlResultSet_isnull(T R, int columnIndex) {
+        TEST_INDEX
+        return R->columns[i].is_null;
+}
+
+
+int MysqlResultSet_getInt(T R, int columnIndex) {
+        long long int l = MysqlResultSet_getLLong(R, columnIndex);
+        if (l < INT_MIN || l > INT_MAX)
+                THROW(SQLException, "NumberFormatException: For input string %lld -- Numerical result out of range", l);
+        return (int)l;
+}
+
+
+/* Integer columns are read as fetched, other columns are parsed from text */
+long long int MysqlResultSet_getLLong(T R, int columnIndex) {
+        TEST_INDEX
+        if (R->columns[i].is_null)
+                return 0;
+        if (R->columns[i].isInteger)
+                return R->columns[i].integer;
+        return Str_parseLLong(MysqlResultSet_getString(R, columnIndex));
+}
+
+
+double MysqlResultSet_getDouble(T R, int columnIndex) {
+        TEST_INDEX
+        if (R->columns[i].is_null)
+                return 0.0;
+        if (R->columns[i].isInteger)
+                return (double)R->columns[i].integer;
+        return Str_parseDouble(MysqlResultSet_getString(R, columnIndex));
+}
+
+
+int MysqlResultSet_getColumnType(T R, int columnIndex) {
+        TEST_INDEX
+        if (R->columns[i].isInteger)
+                return ColumnType_Integer;
+        switch (R->columns[i].field->type) {
+                case MYSQL_TYPE_FLOAT:
+                case MYSQL_TYPE_DOUBLE: return ColumnType_Real;
+                case MYSQL_TYPE_TINY_BLOB:
+                case MYSQL_TYPE_MEDIUM_BLOB:
+                case MYSQL_TYPE_LONG_BLOB:
+                case MYSQL_TYPE_BLOB:
+                case MYSQL_TYPE_VAR_STRING:
+                case MYSQL_TYPE_STRING:
+                        /* Binary strings and blobs have the binary character set */
+                        return (R->columns[i].field->charsetnr == 63) ? ColumnType_Blob : ColumnType_Text;
+                default: return ColumnType_Text;
+        }
+}
+
+
+/* A value larger than the column buffer is fetched from the offset directly into
+ the caller's buffer so only the requested part is copied */
+int MysqlResultSet_readBlob(T R, int columnIndex, void *buffer, int size, int offset) {
+        TEST_INDEX
+        if (R->columns[i].is_null)
+                return 0;
+        const char *value = R->columns[i].buffer;
+        unsigned long length = R->columns[i].isInteger ? formatInteger(R, i) : R->columns[i].real_length;
+        if ((unsigned long)offset >= length)
+                return 0;
+        if ((unsigned long)size > length - offset)
+                size = (int)(length - offset);
+        if (R->columns[i].isInteger || length <= R->bind[i].buffer_length) {
+                memcpy(buffer, value + offset, size);
+        } else {
+                unsigned long fetched = 0;
+                MYSQL_BIND bind = {.buffer_type = MYSQL_TYPE_BLOB, .buffer = buffer, .buffer_length = size, .length = &fetched};
+                if ((R->lastError = mysql_stmt_fetch_column(R->stmt, &bind, i, offset)))
+                        THROW(SQLException, "mysql_stmt_fetch_column -- %s", mysql_stmt_error(R->stmt));
+        }
+        return size;
+}
+
 #ifdef PACKAGE_PROTECTED
 #pragma GCC visibility pop
 #endif
@@ -23,8 +23,24 @@
  */
 #ifndef MYSQLRESULTSET_INCLUDED
 #define MYSQLRESULTSET_INCLUDED
+/* How the rows of a query are fetched, see the URL option result-mode */
+typedef enum {
+        MYSQL_RESULT_CURSOR = 0,
+        MYSQL_RESULT_BUFFERED,
+        MYSQL_RESULT_STREAM
+} MysqlResultMode_T;
+/* The result set streaming rows on a connection in stream mode. No other command can
+ run on the connection until all rows are read, so the connection drains it first */
+typedef struct MysqlStream_S {
+        void *R;                // The result set delegate streaming, NULL if none
+        void (*drain)(void *R); // Read and discard the rows not fetched
+} *MysqlStream_T;
+static inline void MysqlStream_drain(MysqlStream_T S) {
+        if (S && S->R)
+                S->drain(S->R);
+}
 #define T ResultSetDelegate_T
-T MysqlResultSet_new(void *stmt, int maxRows, int keep);
+T MysqlResultSet_new(void *stmt, int maxRows, int keep, MysqlStream_T stream);
 void MysqlResultSet_free(T *R);
 int MysqlResultSet_getColumnCount(T R);
 const char *MysqlResultSet_getColumnName(T R, int column);
@@ -32,5 +48,11 @@ int MysqlResultSet_next(T R);
 long MysqlResultSet_getColumnSize(T R, int columnIndex);
 const char *MysqlResultSet_getString(T R, int columnIndex);
 const void *MysqlResultSet_getBlob(T R, int columnIndex, int *size);
+int MysqlResultSet_isnull(T R, int columnIndex);
+int MysqlResultSet_getInt(T R, int columnIndex);
+long long int MysqlResultSet_getLLong(T R, int columnIndex);
+double MysqlResultSet_getDouble(T R, int columnIndex);
+int MysqlResultSet_getColumnType(T R, int columnIndex);
+int MysqlResultSet_readBlob(T R, int columnIndex, void *buffer, int size, int offset);
 #undef T
 #endif
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+
+
+#include "Config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <mysql.h>
+
+#include "ResultSetDelegate.h"
+#include "MysqlResultSet.h"
+#include "MysqlTextResultSet.h"
+
+
+/**
+ * Implementation of the ResultSet/Delegate interface for mysql queries sent
+ * with the text protocol. Connection_executeQuery() uses this result set in
+ * buffered and stream result-mode to run a query in one round trip instead
+ * of preparing, executing and closing a statement. Values are read as text as sent by the server. 
+ * Accessing columns with index outside range throws SQLException
+ *
+ * @file
+ */
+
+
+/* ----------------------------------------------------------- Definitions */
+
+
+const struct Rop_T mysqltextrops = {
+	"mysql",
+        MysqlTextResultSet_free,
+        MysqlTextResultSet_getColumnCount,
+        MysqlTextResultSet_getColumnName,
+        MysqlTextResultSet_next,
+        MysqlTextResultSet_getColumnSize,
+        MysqlTextResultSet_getString,
+        MysqlTextResultSet_getBlob,
+        NULL,
+        MysqlTextResultSet_isnull,
+        NULL,
+        NULL,
+        NULL,
+        MysqlTextResultSet_fetchBatch,
+        MysqlTextResultSet_getColumnType
+};
+
+#define T ResultSetDelegate_T
+struct T {
+        int stop;
+        int maxRows;
+	int currentRow;
+	int columnCount;
+        MYSQL *db;
+        MYSQL_RES *res;
+        MYSQL_ROW row;
+        MYSQL_FIELD *fields;
+        unsigned long *lengths;
+        MysqlStream_T stream;
+};
+
+#define TEST_INDEX \
+        int i; assert(R);i = columnIndex-1; if (R->columnCount <= 0 || \
+        i < 0 || i >= R->columnCount) { THROW(SQLException, "Column index is out of range"); } \
+        if (! R->row) { THROW(SQLException, "No current row"); }
+
+
+/* ------------------------------------------------------- Private methods */
+
+
+/* Discard the remaining results of a multi-statement query */
+static void discardResults(T R) {
+        while (mysql_next_result(R->db) == 0) {
+                MYSQL_RES *res = mysql_store_result(R->db);
+                if (res)
+                        mysql_free_result(res);
+        }
+}
+
+
+static void endStream(T R) {
+        if (R->stream && R->stream->R == R)
+                R->stream->R = NULL;
+}
+
+
+/* Read and discard the rows of a streamed result not fetched so the connection can run another command */
+static void drain(void *R) {
+        T r = R;
+        while (mysql_fetch_row(r->res))
+                ;
+        discardResults(r);
+        r->stop = true;
+        r->row = NULL;
+        endStream(r);
+}
+
+
+/* ----------------------------------------------------- Protected methods */
+
+
+#ifdef PACKAGE_PROTECTED
+#pragma GCC visibility push(hidden)
+#endif
+
+/* The result, res, is from mysql_store_result() or mysql_use_result() and is
+ NULL if the query did not return rows. If stream is given the result is from 
+ mysql_use_result() and is registered as the connection's pending stream */
+T MysqlTextResultSet_new(void *db, void *res, int maxRows, MysqlStream_T stream) {
+	T R;
+	assert(db);
+	NEW(R);
+        R->db = db;
+        R->res = res;
+        R->maxRows = maxRows;
+        if (R->res) {
+                R->columnCount = mysql_num_fields(R->res);
+                R->fields = mysql_fetch_fields(R->res);
+                if (stream) {
+                        R->stream = stream;
+                        stream->R = R;
+                        stream->drain = drain;
+                }
+        } else {
+                R->stop = true;
+        }
+	return R;
+}
+
+
+/* Freeing a streamed result reads the rows not fetched. Remaining results of
+ a multi-statement query are discarded so the connection can be used again */
+void MysqlTextResultSet_free(T *R) {
+	assert(R && *R);
+        endStream(*R);
+        if ((*R)->res)
+                mysql_free_result((*R)->res);
+        discardResults(*R);
+	FREE(*R);
+}
+
+
+int MysqlTextResultSet_getColumnCount(T R) {
+	assert(R);
+	return R->columnCount;
+}
+
+
+const char *MysqlTextResultSet_getColumnName(T R, int column) {
+	assert(R);
+	column--;
+	if (R->columnCount <= 0 ||
+	   column < 0           ||
+	   column >= R->columnCount)
+		return NULL;
+	return R->fields[column].name;
+}
+
+
+int MysqlTextResultSet_next(T R) {
+	assert(R);
+        if (R->stop)
+                return false;
+        if (R->maxRows && (R->currentRow++ >= R->maxRows)) {
+                R->stop = true;
+                R->row = NULL;
+                return false;
+        }
+        if (! (R->row = mysql_fetch_row(R->res))) {
+                R->stop = true;
+                endStream(R);
+                if (mysql_errno(R->db))
+                        THROW(SQLException, "mysql_fetch_row -- %s", mysql_error(R->db));
+                return false;
+        }
+        R->lengths = mysql_fetch_lengths(R->res);
+        return true;
+}
+
+
+long MysqlTextResultSet_getColumnSize(T R, int columnIndex) {
+        TEST_INDEX
+        return R->row[i] ? (long)R->lengths[i] : 0;
+}
+
+
+const char *MysqlTextResultSet_getString(T R, int columnIndex) {
+        TEST_INDEX
+        return R->row[i];
+}
+
+
+const void *MysqlTextResultSet_getBlob(T R, int columnIndex, int *size) {
+        TEST_INDEX
+        *size = (int)R->lengths[i];
+        return R->row[i];
+}
+
+
+int MysqlTextResultSet_isnull(T R, int columnIndex) {
+        TEST_INDEX
+        return (R->row[i] == NULL);
+}
+
+
+int MysqlTextResultSet_fetchBatch(T R, int maxRows, RowBuffer_T B) {
+        int rows = 0;
+        assert(R);
+        while (rows < maxRows && MysqlTextResultSet_next(R)) {
+                for (int i = 0; i < R->columnCount; i++)
+                        RowBuffer_append(B, R->row[i], R->row[i] ? (long)R->lengths[i] : 0);
+                rows++;
+        }
+        return rows;
+}
+
+
+int MysqlTextResultSet_getColumnType(T R, int columnIndex) {
+        int i;
+        assert(R);
+        i = columnIndex - 1;
+        if (R->columnCount <= 0 || i < 0 || i >= R->columnCount)
+                THROW(SQLException, "Column index is out of range");
+        MYSQL_FIELD *field = &R->fields[i];
+        switch (field->type) {
+                case MYSQL_TYPE_TINY:
+                case MYSQL_TYPE_SHORT:
+                case MYSQL_TYPE_INT24:
+                case MYSQL_TYPE_LONG:
+                        return (field->flags & ZEROFILL_FLAG) ? ColumnType_Text : ColumnType_Integer;
+                case MYSQL_TYPE_LONGLONG:
+                        return (field->flags & (ZEROFILL_FLAG | UNSIGNED_FLAG)) ? ColumnType_Text : ColumnType_Integer;
+                case MYSQL_TYPE_FLOAT:
+                case MYSQL_TYPE_DOUBLE: return ColumnType_Real;
+                case MYSQL_TYPE_TINY_BLOB:
+                case MYSQL_TYPE_MEDIUM_BLOB:
+                case MYSQL_TYPE_LONG_BLOB:
+                case MYSQL_TYPE_BLOB:
+                case MYSQL_TYPE_VAR_STRING:
+                case MYSQL_TYPE_STRING:
+                        /* Binary strings and blobs have the binary character set */
+                        return (field->charsetnr == 63) ? ColumnType_Blob : ColumnType_Text;
+                default: return ColumnType_Text;
+        }
+}
+
+#ifdef PACKAGE_PROTECTED
+#pragma GCC visibility pop
+#endif
+
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+#ifndef MYSQLTEXTRESULTSET_INCLUDED
+#define MYSQLTEXTRESULTSET_INCLUDED
+#define T ResultSetDelegate_T
+T MysqlTextResultSet_new(void *db, void *res, int maxRows, MysqlStream_T stream);
+void MysqlTextResultSet_free(T *R);
+int MysqlTextResultSet_getColumnCount(T R);
+const char *MysqlTextResultSet_getColumnName(T R, int column);
+int MysqlTextResultSet_next(T R);
+long MysqlTextResultSet_getColumnSize(T R, int columnIndex);
+const char *MysqlTextResultSet_getString(T R, int columnIndex);
+const void *MysqlTextResultSet_getBlob(T R, int columnIndex, int *size);
+int MysqlTextResultSet_isnull(T R, int columnIndex);
+int MysqlTextResultSet_fetchBatch(T R, int maxRows, RowBuffer_T B);
+int MysqlTextResultSet_getColumnType(T R, int columnIndex);
+#undef T
+#endif
@@ -37,6 +37,7 @@
 #include "ResultSet.h"
 #include "StringBuffer.h"
 #include "PreparedStatement.h"
+#include "Blob.h"
 #include "OracleResultSet.h"
 #include "OraclePreparedStatement.h"
 #include "ConnectionDelegate.h"
@@ -70,7 +71,10 @@ const struct Cop_T oraclesqlcops = {
         OracleConnection_execute,
         OracleConnection_executeQuery,
         OracleConnection_prepareStatement,
-        OracleConnection_getLastError
+        OracleConnection_getLastError,
+        NULL,
+        NULL,
+        NULL
 };
 
 #define ERB_SIZE 152
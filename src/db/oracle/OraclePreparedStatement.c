@@ -38,6 +38,7 @@
 #include "ResultSet.h"
 #include "StringBuffer.h"
 #include "PreparedStatement.h"
+#include "Blob.h"
 #include "OracleResultSet.h"
 #include "OraclePreparedStatement.h"
 #include "ConnectionDelegate.h"
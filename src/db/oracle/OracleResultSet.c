@@ -37,6 +37,7 @@
 #include "ResultSet.h"
 #include "StringBuffer.h"
 #include "PreparedStatement.h"
+#include "Blob.h"
 #include "OracleResultSet.h"
 #include "OraclePreparedStatement.h"
 #include "ConnectionDelegate.h"
@@ -62,6 +63,14 @@ const struct Rop_T oraclerops = {
         OracleResultSet_getColumnSize,
         OracleResultSet_getString,
         OracleResultSet_getBlob,
+        NULL,
+        OracleResultSet_isnull,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        OracleResultSet_readBlob
 };
 typedef struct column_t {
         OCIDefine *def;
@@ -318,6 +327,37 @@ const void *OracleResultSet_getBlob(T R, int columnIndex, int *size) {
         return (const void *)R->columns[i].buffer;
 }
 
+
+int OracleResultSet_isnull(T R, int columnIndex) {
+        TEST_INDEX
+        return (R->columns[i].isNull != 0);
+}
+
+
+/* A LOB is read from the server at the offset, one piece into the caller's buffer */
+int OracleResultSet_readBlob(T R, int columnIndex, void *buffer, int size, int offset) {
+        TEST_INDEX
+        if (R->columns[i].isNull || size == 0)
+                return 0;
+        if (! R->columns[i].lob_loc) {
+                if (! R->columns[i].buffer || offset >= R->columns[i].length)
+                        return 0;
+                if (size > R->columns[i].length - offset)
+                        size = (int)(R->columns[i].length - offset);
+                memcpy(buffer, R->columns[i].buffer + offset, size);
+                return size;
+        }
+        oraub8 read_chars = 0;
+        oraub8 read_bytes = size;
+        R->lastError = OCILobRead2(R->svc, R->err, R->columns[i].lob_loc, &read_bytes, &read_chars, (oraub8)offset + 1, 
+                                   buffer, size, OCI_ONE_PIECE, NULL, NULL, 0, SQLCS_IMPLICIT);
+        if (R->lastError == OCI_NO_DATA)
+                return 0;
+        if (R->lastError != OCI_SUCCESS && R->lastError != OCI_SUCCESS_WITH_INFO)
+                THROW(SQLException, "%s", OraclePreparedStatement_getLastError(R->lastError, R->err));
+        return (int)read_bytes;
+}
+
 #ifdef PACKAGE_PROTECTED
 #pragma GCC visibility pop
 #endif
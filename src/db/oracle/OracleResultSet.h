@@ -43,5 +43,7 @@ double OracleResultSet_getDouble(T R, int columnIndex);
 double OracleResultSet_getDoubleByName(T R, const char *columnName);
 const void *OracleResultSet_getBlob(T R, int columnIndex, int *size);
 const void *OracleResultSet_getBlobByName(T R, const char *columnName, int *size);
+int OracleResultSet_isnull(T R, int columnIndex);
+int OracleResultSet_readBlob(T R, int columnIndex, void *buffer, int size, int offset);
 #undef T
 #endif
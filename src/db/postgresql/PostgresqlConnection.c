@@ -33,9 +33,10 @@
 #include "ResultSet.h"
 #include "StringBuffer.h"
 #include "PreparedStatement.h"
+#include "Blob.h"
 #include "PostgresqlResultSet.h"
-#include "PostgresqlPreparedStatement.h"
 #include "ConnectionDelegate.h"
+#include "PostgresqlPreparedStatement.h"
 #include "PostgresqlConnection.h"
 
 
@@ -65,7 +66,10 @@ const struct Cop_T postgresqlcops = {
         PostgresqlConnection_execute,
         PostgresqlConnection_executeQuery,
         PostgresqlConnection_prepareStatement,
-        PostgresqlConnection_getLastError
+        PostgresqlConnection_getLastError,
+        NULL,
+        NULL,
+        NULL
 };
 
 #define T ConnectionDelegate_T
@@ -73,8 +77,12 @@ struct T {
         URL_T url;
 	PGconn *db;
 	PGresult *res;
+        ResultSetDelegate_T stream;
 	int maxRows;
+        int fetchSize;
 	int timeout;
+        int serverTimeout;
+        int timeoutInTransaction;
 	ExecStatusType lastError;
         StringBuffer_T sb;
 };
@@ -133,6 +141,15 @@ static int doConnect(T C, char **error) {
                 StringBuffer_append(C->sb, "connect_timeout=%d ", SQL_DEFAULT_TCP_TIMEOUT);
         if (URL_getParameter(C->url, "application-name"))
                 StringBuffer_append(C->sb, "application_name='%s' ", URL_getParameter(C->url, "application-name"));
+        if (URL_getParameter(C->url, "fetch-size")) {
+                TRY
+                        C->fetchSize = Str_parseInt(URL_getParameter(C->url, "fetch-size"));
+                ELSE
+                        C->fetchSize = -1;
+                END_TRY;
+                if (C->fetchSize < 0)
+                        ERROR("invalid fetch size value");
+        }
         /* Connect */
         C->db = PQconnectdb(StringBuffer_toString(C->sb));
         if (PQstatus(C->db) == CONNECTION_OK)
@@ -143,6 +160,62 @@ error:
 }
 
 
+/* Record the outcome of sending statement_timeout. SET is transactional in
+ Postgres, so the value is lost if the statement fails or the surrounding 
+ transaction is rolled back. In that case we no longer know the server value
+ and mark it as unknown (-1) so it is sent again with the next statement */
+static inline void timeoutApplied(T C, int success) {
+        if (success) {
+                C->serverTimeout = C->timeout;
+                if (PQtransactionStatus(C->db) != PQTRANS_IDLE)
+                        C->timeoutInTransaction = true;
+        } else {
+                C->serverTimeout = -1;
+        }
+}
+
+
+/* Positions of the list parameters in a statement, see StringBuffer_mapLists() */
+struct list_t {
+        int count;
+        int *positions;
+};
+
+
+static void addList(int parameterIndex, void *ap) {
+        struct list_t *lists = ap;
+        lists->positions[lists->count++] = parameterIndex;
+}
+
+
+/* A streamed result set holds the connection until all its rows are read. Stop it
+ before another command is sent, otherwise the command would read its rows */
+static inline void endStream(T C) {
+        if (C->stream)
+                PostgresqlResultSet_finish(C->stream);
+}
+
+
+/* Send the query in the string buffer and stream its rows, see fetch-size */
+static ResultSet_T streamQuery(T C) {
+        PostgresqlConnection_applyQueryTimeout(C);
+        // A query can only be cancelled without side effects outside a transaction
+        int cancel = (PQtransactionStatus(C->db) == PQTRANS_IDLE);
+        C->res = NULL;
+        if (PQsendQuery(C->db, StringBuffer_toString(C->sb))) {
+                ResultSetDelegate_T R = PostgresqlResultSet_newStream(C->db, C->maxRows, C->fetchSize, cancel, (void **)&C->stream, (void **)&C->res);
+                if (R) {
+                        C->lastError = PGRES_TUPLES_OK;
+                        return ResultSet_new(R, (Rop_T)&postgresqlrops);
+                }
+        } else {
+                C->res = PQmakeEmptyPGresult(C->db, PGRES_FATAL_ERROR);
+        }
+        C->lastError = PQresultStatus(C->res);
+        return NULL;
+}
+
+
 /* ----------------------------------------------------- Protected methods */
 
 
@@ -158,6 +231,8 @@ T PostgresqlConnection_new(URL_T url, char **error) {
         C->url = url;
         C->sb = StringBuffer_create(STRLEN);
         C->timeout = SQL_DEFAULT_TIMEOUT;
+        // The server starts with its configured statement_timeout, unknown here, so the first timeout is always sent
+        C->serverTimeout = -1;
         if (! doConnect(C, error))
                 PostgresqlConnection_free(&C);
 	return C;
@@ -175,13 +250,11 @@ void PostgresqlConnection_free(T *C) {
 }
 
 
+/* The timeout is applied lazily before the next statement sent to the server and
+ only if it differs from the value already in effect. See PostgresqlConnection_applyQueryTimeout() */
 void PostgresqlConnection_setQueryTimeout(T C, int ms) {
 	assert(C);
         C->timeout = ms;
-        StringBuffer_clear(C->sb);
-        StringBuffer_append(C->sb, "SET statement_timeout TO %d;", C->timeout);
-        PGresult *res = PQexec(C->db, StringBuffer_toString(C->sb));
-        PQclear(res);
 }
 
 
@@ -200,6 +273,7 @@ int PostgresqlConnection_ping(T C) {
 
 int PostgresqlConnection_beginTransaction(T C) {
 	assert(C);
+        endStream(C);
         PGresult *res = PQexec(C->db, "BEGIN TRANSACTION;");
         C->lastError = PQresultStatus(res);
         PQclear(res);
@@ -209,8 +283,15 @@ int PostgresqlConnection_beginTransaction(T C) {
 
 int PostgresqlConnection_commit(T C) {
 	assert(C);
+        endStream(C);
         PGresult *res = PQexec(C->db, "COMMIT TRANSACTION;");
         C->lastError = PQresultStatus(res);
+        if (C->timeoutInTransaction) {
+                // Commit of an aborted transaction is reported as a ROLLBACK
+                if (C->lastError != PGRES_COMMAND_OK || IS(PQcmdStatus(res), "ROLLBACK"))
+                        C->serverTimeout = -1;
+                C->timeoutInTransaction = false;
+        }
         PQclear(res);
         return (C->lastError == PGRES_COMMAND_OK);
 }
@@ -218,9 +299,14 @@ int PostgresqlConnection_commit(T C) {
 
 int PostgresqlConnection_rollback(T C) {
 	assert(C);
+        endStream(C);
         PGresult *res = PQexec(C->db, "ROLLBACK TRANSACTION;");
         C->lastError = PQresultStatus(res);
         PQclear(res);
+        if (C->timeoutInTransaction) {
+                C->serverTimeout = -1;
+                C->timeoutInTransaction = false;
+        }
         return (C->lastError == PGRES_COMMAND_OK);
 }
 
@@ -240,11 +326,13 @@ long long int PostgresqlConnection_rowsChanged(T C) {
 int PostgresqlConnection_execute(T C, const char *sql, va_list ap) {
         va_list ap_copy;
 	assert(C);
+        endStream(C);
         PQclear(C->res);
         StringBuffer_clear(C->sb);
         va_copy(ap_copy, ap);
         StringBuffer_vappend(C->sb, sql, ap_copy);
         va_end(ap_copy);
+        PostgresqlConnection_applyQueryTimeout(C);
         C->res = PQexec(C->db, StringBuffer_toString(C->sb));
         C->lastError = PQresultStatus(C->res);
         return (C->lastError == PGRES_COMMAND_OK);
@@ -254,11 +342,19 @@ int PostgresqlConnection_execute(T C, const char *sql, va_list ap) {
 ResultSet_T PostgresqlConnection_executeQuery(T C, const char *sql, va_list ap) {
         va_list ap_copy;
 	assert(C);
+        endStream(C);
         PQclear(C->res);
         StringBuffer_clear(C->sb);
+        if (C->fetchSize) {
+                va_copy(ap_copy, ap);
+                StringBuffer_vappend(C->sb, sql, ap_copy);
+                va_end(ap_copy);
+                return streamQuery(C);
+        }
         va_copy(ap_copy, ap);
         StringBuffer_vappend(C->sb, sql, ap_copy);
         va_end(ap_copy);
+        PostgresqlConnection_applyQueryTimeout(C);
         C->res = PQexec(C->db, StringBuffer_toString(C->sb));
         C->lastError = PQresultStatus(C->res);
         if (C->lastError == PGRES_TUPLES_OK)
@@ -273,18 +369,67 @@ PreparedStatement_T PostgresqlConnection_prepareStatement(T C, const char *sql,
         va_list ap_copy;
         assert(C);
         assert(sql);
+        endStream(C);
         PQclear(C->res);
         StringBuffer_clear(C->sb);
         va_copy(ap_copy, ap);
         StringBuffer_vappend(C->sb, sql, ap_copy);
         va_end(ap_copy);
-        paramCount = StringBuffer_prepare4postgres(C->sb);
+        // Record the position of each list parameter before the lists are rewritten to arrays
+        int listCount = StringBuffer_mapLists(C->sb, NULL, NULL);
+        struct list_t lists = {.positions = listCount ? ALLOC(listCount * sizeof(int)) : NULL};
+        if (listCount) {
+                StringBuffer_mapLists(C->sb, addList, &lists);
+                StringBuffer_prepareAny(C->sb);
+        }
+        TRY
+        {
+                paramCount = StringBuffer_prepare4postgres(C->sb);
+        }
+        ELSE
+        {
+                FREE(lists.positions);
+                RETHROW;
+        }
+        END_TRY;
         uint32_t t = ++statementid; // increment is atomic
         name = Str_cat("%d", t);
         C->res = PQprepare(C->db, name, StringBuffer_toString(C->sb), 0, NULL);
+        PreparedStatement_T p = NULL;
         if (C->res && (C->lastError == PGRES_EMPTY_QUERY || C->lastError == PGRES_COMMAND_OK || C->lastError == PGRES_TUPLES_OK))
-		return PreparedStatement_new(PostgresqlPreparedStatement_new(C->db, C->maxRows, name, paramCount), (Pop_T)&postgresqlpops);
-        return NULL;
+		p = PreparedStatement_new(PostgresqlPreparedStatement_new(C, C->db, C->maxRows, C->fetchSize, name, paramCount, lists.positions, listCount), (Pop_T)&postgresqlpops);
+        FREE(lists.positions);
+        return p;
+}
+
+
+/* Used by prepared statements before they send a command, see endStream() */
+void PostgresqlConnection_endStream(T C) {
+        assert(C);
+        endStream(C);
+}
+
+
+/* Used by prepared statements to register a streamed result set, see PostgresqlResultSet_newStream() */
+void **PostgresqlConnection_getStream(T C) {
+        assert(C);
+        return (void **)&C->stream;
+}
+
+
+/* Send statement_timeout as a command of its own before the next statement. A SET
+ prefixed to the statement would make a multi-statement implicit transaction, in
+ which VACUUM and other statements cannot run. This cost a round trip, but only
+ when the timeout has changed */
+void PostgresqlConnection_applyQueryTimeout(T C) {
+        assert(C);
+        if (C->timeout != C->serverTimeout) {
+                char stmt[STRLEN];
+                snprintf(stmt, STRLEN, "SET statement_timeout TO %d;", C->timeout);
+                PGresult *res = PQexec(C->db, stmt);
+                timeoutApplied(C, PQresultStatus(res) == PGRES_COMMAND_OK);
+                PQclear(res);
+        }
 }
 
 
@@ -26,13 +26,22 @@
 #include "Config.h"
 
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <float.h>
 #include <libpq-fe.h>
 
+#include "URL.h"
 #include "ResultSet.h"
+#include "PreparedStatement.h"
+#include "Blob.h"
 #include "PostgresqlResultSet.h"
 #include "PreparedStatementDelegate.h"
+#include "ConnectionDelegate.h"
 #include "PostgresqlPreparedStatement.h"
+#include "PostgresqlConnection.h"
 
 
 /**
@@ -56,23 +65,35 @@ const struct Pop_T postgresqlpops = {
         PostgresqlPreparedStatement_setDouble,
         PostgresqlPreparedStatement_setBlob,
         PostgresqlPreparedStatement_execute,
-        PostgresqlPreparedStatement_executeQuery
+        PostgresqlPreparedStatement_executeQuery,
+        NULL,
+        NULL,
+        PostgresqlPreparedStatement_setLLongArray,
+        PostgresqlPreparedStatement_setStringArray
 };
 
 typedef struct param_t {
         char s[65];
+        int list;       // True if the parameter is a list rewritten to an array, see isArray()
+        int capacity;
+        char *array;
 } *param_t;
 #define T PreparedStatementDelegate_T
 struct T {
         int maxRows;
+        int fetchSize;
+        int described;
+        int resultFormat;
         int lastError;
         char *stmt;
         PGconn *db;
         PGresult *res;
+        ConnectionDelegate_T delegate;
         int paramCount;
         char **paramValues; 
         int *paramLengths; 
         int *paramFormats;
+        Oid *paramTypes;
         param_t params;
 };
 
@@ -80,9 +101,171 @@ struct T {
         int i; assert(P); i = parameterIndex - 1; if (P->paramCount <= 0 || \
         i < 0 || i >= P->paramCount) THROW(SQLException, "Parameter index is out of range");
 
+/* Type OIDs from the server's catalog/pg_type.h */
+#define INT8OID 20
+#define INT2OID 21
+#define INT4OID 23
+#define FLOAT4OID 700
+#define FLOAT8OID 701
+#define BYTEAOID 17
+#define NAMEOID 19
+#define TEXTOID 25
+#define BPCHAROID 1042
+#define VARCHAROID 1043
+#define BYTEAARRAYOID 1001
+#define NAMEARRAYOID 1003
+#define INT2ARRAYOID 1005
+#define INT4ARRAYOID 1007
+#define TEXTARRAYOID 1009
+#define BPCHARARRAYOID 1014
+#define VARCHARARRAYOID 1015
+#define INT8ARRAYOID 1016
+
 extern const struct Rop_T postgresqlrops;
 
 
+/* ------------------------------------------------------- Private methods */
+
+
+/* Describe the statement the first time it is used. The parameter types
+ inferred by the server are used to send numbers in binary format, and the
+ result is fetched in binary format if the result set can decode every column,
+ which saves the text conversion on both sides and halves the size of bytea
+ values. If describe fails, text format is used and it is tried again on the
+ next use */
+static void describe(T P) {
+        if (! P->described) {
+                // The connection cannot describe while a result is streamed
+                PostgresqlConnection_endStream(P->delegate);
+                PGresult *res = PQdescribePrepared(P->db, P->stmt);
+                if (PQresultStatus(res) == PGRES_COMMAND_OK) {
+                        for (int i = 0; i < P->paramCount && i < PQnparams(res); i++)
+                                P->paramTypes[i] = PQparamtype(res, i);
+                        P->resultFormat = PostgresqlResultSet_decodes(P->db, res);
+                        P->described = true;
+                }
+                PQclear(res);
+        }
+}
+
+
+/* Write the n low order bytes of x in network byte order */
+static inline void writeInteger(char *s, unsigned long long int x, int n) {
+        for (int i = n - 1; i >= 0; i--, x >>= 8)
+                s[i] = (char)(x & 0xff);
+}
+
+
+static inline void bindBinary(T P, int i, int size) {
+        P->paramValues[i] = P->params[i].s;
+        P->paramLengths[i] = size;
+        P->paramFormats[i] = 1;
+}
+
+
+static inline void bindText(T P, int i) {
+        P->paramValues[i] = P->params[i].s;
+        P->paramLengths[i] = 0;
+        P->paramFormats[i] = 0;
+}
+
+
+/* Return room for size bytes in the array buffer of parameter i */
+static char *getArray(T P, int i, int size) {
+        if (size > P->params[i].capacity) {
+                FREE(P->params[i].array);
+                P->params[i].array = ALLOC(size);
+                P->params[i].capacity = size;
+        }
+        return P->params[i].array;
+}
+
+
+static inline void bindArray(T P, int i, int size, int format) {
+        P->paramValues[i] = P->params[i].array;
+        P->paramLengths[i] = format ? size : 0;
+        P->paramFormats[i] = format;
+}
+
+
+/* Write the header of a one dimensional array in binary format and return its size */
+static int writeArrayHeader(char *s, int count, int nulls, Oid element) {
+        writeInteger(s, count ? 1 : 0, 4);
+        writeInteger(s + 4, nulls, 4);
+        writeInteger(s + 8, element, 4);
+        if (! count)
+                return 12;
+        writeInteger(s + 12, count, 4);
+        writeInteger(s + 16, 1, 4);
+        return 20;
+}
+
+
+/* A list parameter, IN (?) rewritten to = ANY($n), is an array parameter and a
+ single value set is sent as an array of one, whatever the element type */
+static inline int isArray(T P, int i) {
+        return P->params[i].list;
+}
+
+
+/* Bind a double in binary format to a float parameter, otherwise as text with
+ the fewest digits that read back as the same value */
+static void bindDouble(T P, int i, double x) {
+        describe(P);
+        if (P->paramTypes[i] == FLOAT8OID) {
+                union { double d; uint64_t i; } u = {.d = x};
+                writeInteger(P->params[i].s, u.i, 8);
+                bindBinary(P, i, 8);
+        } else if (P->paramTypes[i] == FLOAT4OID) {
+                union { float f; uint32_t i; } u = {.f = (float)x};
+                writeInteger(P->params[i].s, u.i, 4);
+                bindBinary(P, i, 4);
+        } else {
+                for (int digits = DBL_DIG; digits <= 17; digits++) {
+                        snprintf(P->params[i].s, 64, "%.*g", digits, x);
+                        if (strtod(P->params[i].s, NULL) == x)
+                                break;
+                }
+                bindText(P, i);
+        }
+}
+
+
+/* Bind an integer in binary format to an integer parameter it fits in or to a
+ float parameter, otherwise as text and the server reports any range error */
+static void bindLLong(T P, int i, long long int x) {
+        if (isArray(P, i)) {
+                PostgresqlPreparedStatement_setLLongArray(P, i + 1, &x, 1);
+                return;
+        }
+        describe(P);
+        switch (P->paramTypes[i]) {
+                case INT2OID:
+                        if (x < INT16_MIN || x > INT16_MAX)
+                                break;
+                        writeInteger(P->params[i].s, x, 2);
+                        bindBinary(P, i, 2);
+                        return;
+                case INT4OID:
+                        if (x < INT32_MIN || x > INT32_MAX)
+                                break;
+                        writeInteger(P->params[i].s, x, 4);
+                        bindBinary(P, i, 4);
+                        return;
+                case INT8OID:
+                        writeInteger(P->params[i].s, x, 8);
+                        bindBinary(P, i, 8);
+                        return;
+                case FLOAT4OID:
+                case FLOAT8OID:
+                        bindDouble(P, i, (double)x);
+                        return;
+        }
+        snprintf(P->params[i].s, 64, "%lld", x);
+        bindText(P, i);
+}
+
+
 /* ----------------------------------------------------- Protected methods */
 
 
@@ -90,21 +273,28 @@ extern const struct Rop_T postgresqlrops;
 #pragma GCC visibility push(hidden)
 #endif
 
-T PostgresqlPreparedStatement_new(PGconn *db, int maxRows, char *stmt, int paramCount) {
+T PostgresqlPreparedStatement_new(ConnectionDelegate_T delegate, PGconn *db, int maxRows, int fetchSize, char *stmt, int paramCount, const int *lists, int listCount) {
         T P;
+        assert(delegate);
         assert(db);
         assert(stmt);
         NEW(P);
         P->db = db;
+        P->delegate = delegate;
         P->stmt = stmt;
         P->maxRows = maxRows;
+        P->fetchSize = fetchSize;
         P->paramCount = paramCount;
         P->lastError = PGRES_COMMAND_OK;
         if (P->paramCount) {
                 P->paramValues = CALLOC(P->paramCount, sizeof(char *));
                 P->paramLengths = CALLOC(P->paramCount, sizeof(int));
                 P->paramFormats = CALLOC(P->paramCount, sizeof(int));
+                P->paramTypes = CALLOC(P->paramCount, sizeof(Oid));
                 P->params = CALLOC(P->paramCount, sizeof(struct param_t));
+                for (int k = 0; k < listCount; k++)
+                        if (lists[k] > 0 && lists[k] <= P->paramCount)
+                                P->params[lists[k] - 1].list = true;
         }
         return P;
 }
@@ -118,6 +308,7 @@ void PostgresqlPreparedStatement_free(T *P) {
          * has to be used. The postgres documentation mentiones such
          * function as a possible future extension */
         snprintf(stmt, STRLEN, "DEALLOCATE \"%s\";", (*P)->stmt);
+        PostgresqlConnection_endStream((*P)->delegate);
         PQclear(PQexec((*P)->db, stmt));
         PQclear((*P)->res);
 	FREE((*P)->stmt);
@@ -125,6 +316,9 @@ void PostgresqlPreparedStatement_free(T *P) {
 	        FREE((*P)->paramValues);
 	        FREE((*P)->paramLengths);
 	        FREE((*P)->paramFormats);
+	        FREE((*P)->paramTypes);
+                for (int i = 0; i < (*P)->paramCount; i++)
+                        FREE((*P)->params[i].array);
 	        FREE((*P)->params);
         }
 	FREE(*P);
@@ -133,6 +327,10 @@ void PostgresqlPreparedStatement_free(T *P) {
 
 void PostgresqlPreparedStatement_setString(T P, int parameterIndex, const char *x) {
         TEST_INDEX
+        if (isArray(P, i)) {
+                PostgresqlPreparedStatement_setStringArray(P, parameterIndex, &x, 1);
+                return;
+        }
         P->paramValues[i] = (char *)x;
         P->paramLengths[i] = 0;
         P->paramFormats[i] = 0;
@@ -141,41 +339,148 @@ void PostgresqlPreparedStatement_setString(T P, int parameterIndex, const char *
 
 void PostgresqlPreparedStatement_setInt(T P, int parameterIndex, int x) {
         TEST_INDEX
-        snprintf(P->params[i].s, 64, "%d", x);
-        P->paramValues[i] =  P->params[i].s;
-        P->paramLengths[i] = 0;
-        P->paramFormats[i] = 0;
+        bindLLong(P, i, x);
 }
 
 
 void PostgresqlPreparedStatement_setLLong(T P, int parameterIndex, long long int x) {
         TEST_INDEX
-        snprintf(P->params[i].s, 64, "%lld", x);
-        P->paramValues[i] =  P->params[i].s;
-        P->paramLengths[i] = 0; 
-        P->paramFormats[i] = 0;
+        bindLLong(P, i, x);
 }
 
 
 void PostgresqlPreparedStatement_setDouble(T P, int parameterIndex, double x) {
         TEST_INDEX
-        snprintf(P->params[i].s, 64, "%lf", x);
-        P->paramValues[i] =  P->params[i].s;
-        P->paramLengths[i] = 0;
-        P->paramFormats[i] = 0;
+        if (isArray(P, i)) {
+                snprintf(P->params[i].s, 64, "{%.17g}", x);
+                bindText(P, i);
+                return;
+        }
+        bindDouble(P, i, x);
 }
 
 
 void PostgresqlPreparedStatement_setBlob(T P, int parameterIndex, const void *x, int size) {
         TEST_INDEX
+        if (isArray(P, i)) {
+                describe(P);
+                if (P->paramTypes[i] != BYTEAARRAYOID)
+                        THROW(SQLException, "Parameter %d is a list parameter of another type than bytea", parameterIndex);
+                int length = x ? size : -1;
+                char *s = getArray(P, i, 24 + (x ? size : 0));
+                size = writeArrayHeader(s, 1, ! x, BYTEAOID);
+                writeInteger(s + size, length, 4);
+                size += 4;
+                if (length > 0) {
+                        memcpy(s + size, x, length);
+                        size += length;
+                }
+                bindArray(P, i, size, 1);
+                return;
+        }
         P->paramValues[i] = (char *)x;
         P->paramLengths[i] = (x) ? size : 0;
         P->paramFormats[i] = 1;
 }
 
 
+/* Integer arrays are sent in binary format if every value fits the element
+ type, otherwise as text and the server reports any range error */
+void PostgresqlPreparedStatement_setLLongArray(T P, int parameterIndex, const long long int *x, int count) {
+        TEST_INDEX
+        describe(P);
+        Oid element = 0;
+        int width = 0;
+        switch (P->paramTypes[i]) {
+                case INT2ARRAYOID: element = INT2OID; width = 2; break;
+                case INT4ARRAYOID: element = INT4OID; width = 4; break;
+                case INT8ARRAYOID: element = INT8OID; width = 8; break;
+        }
+        for (int j = 0; width && j < count; j++)
+                if ((width == 2 && (x[j] < INT16_MIN || x[j] > INT16_MAX)) || (width == 4 && (x[j] < INT32_MIN || x[j] > INT32_MAX)))
+                        width = 0;
+        if (width) {
+                char *s = getArray(P, i, 20 + count * (4 + width));
+                int size = writeArrayHeader(s, count, false, element);
+                for (int j = 0; j < count; j++, size += 4 + width) {
+                        writeInteger(s + size, width, 4);
+                        writeInteger(s + size + 4, x[j], width);
+                }
+                bindArray(P, i, size, 1);
+        } else {
+                char *s = getArray(P, i, 3 + count * 22);
+                int size = 0;
+                s[size++] = '{';
+                for (int j = 0; j < count; j++)
+                        size += snprintf(s + size, 22, j ? ",%lld" : "%lld", x[j]);
+                s[size++] = '}';
+                s[size] = 0;
+                bindArray(P, i, size, 0);
+        }
+}
+
+
+/* String arrays are sent in binary format to a text array parameter, otherwise
+ as text with each value quoted */
+void PostgresqlPreparedStatement_setStringArray(T P, int parameterIndex, const char **x, int count) {
+        TEST_INDEX
+        describe(P);
+        Oid element = 0;
+        switch (P->paramTypes[i]) {
+                case NAMEARRAYOID: element = NAMEOID; break;
+                case TEXTARRAYOID: element = TEXTOID; break;
+                case BPCHARARRAYOID: element = BPCHAROID; break;
+                case VARCHARARRAYOID: element = VARCHAROID; break;
+        }
+        int size = 3, nulls = false;
+        for (int j = 0; j < count; j++) {
+                size += x[j] ? 2 * (int)strlen(x[j]) + 4 : 5;
+                nulls |= ! x[j];
+        }
+        if (element) {
+                char *s = getArray(P, i, 20 + size);
+                size = writeArrayHeader(s, count, nulls, element);
+                for (int j = 0; j < count; j++) {
+                        int length = x[j] ? (int)strlen(x[j]) : -1;
+                        writeInteger(s + size, length, 4);
+                        size += 4;
+                        if (length > 0) {
+                                memcpy(s + size, x[j], length);
+                                size += length;
+                        }
+                }
+                bindArray(P, i, size, 1);
+        } else {
+                char *s = getArray(P, i, size);
+                size = 0;
+                s[size++] = '{';
+                for (int j = 0; j < count; j++) {
+                        if (j)
+                                s[size++] = ',';
+                        if (! x[j]) {
+                                memcpy(s + size, "NULL", 4);
+                                size += 4;
+                                continue;
+                        }
+                        s[size++] = '"';
+                        for (const char *c = x[j]; *c; c++) {
+                                if (*c == '"' || *c == '\\')
+                                        s[size++] = '\\';
+                                s[size++] = *c;
+                        }
+                        s[size++] = '"';
+                }
+                s[size++] = '}';
+                s[size] = 0;
+                bindArray(P, i, size, 0);
+        }
+}
+
+
 void PostgresqlPreparedStatement_execute(T P) {
         assert(P);
+        PostgresqlConnection_endStream(P->delegate);
+        PostgresqlConnection_applyQueryTimeout(P->delegate);
         PQclear(P->res);
         P->res = PQexecPrepared(P->db, P->stmt, P->paramCount, (const char **)P->paramValues, P->paramLengths, P->paramFormats, 0);
         P->lastError = PQresultStatus(P->res);
@@ -186,8 +491,27 @@ void PostgresqlPreparedStatement_execute(T P) {
 
 ResultSet_T PostgresqlPreparedStatement_executeQuery(T P) {
         assert(P);
+        PostgresqlConnection_endStream(P->delegate);
+        describe(P);
+        PostgresqlConnection_applyQueryTimeout(P->delegate);
         PQclear(P->res);
-        P->res = PQexecPrepared(P->db, P->stmt, P->paramCount, (const char **)P->paramValues, P->paramLengths, P->paramFormats, 0);
+        if (P->fetchSize) {
+                // A query can only be cancelled without side effects outside a transaction
+                int cancel = (PQtransactionStatus(P->db) == PQTRANS_IDLE);
+                P->res = NULL;
+                if (PQsendQueryPrepared(P->db, P->stmt, P->paramCount, (const char **)P->paramValues, P->paramLengths, P->paramFormats, P->resultFormat)) {
+                        ResultSetDelegate_T R = PostgresqlResultSet_newStream(P->db, P->maxRows, P->fetchSize, cancel, PostgresqlConnection_getStream(P->delegate), (void **)&P->res);
+                        if (R) {
+                                P->lastError = PGRES_TUPLES_OK;
+                                return ResultSet_new(R, (Rop_T)&postgresqlrops);
+                        }
+                } else {
+                        P->res = PQmakeEmptyPGresult(P->db, PGRES_FATAL_ERROR);
+                }
+                P->lastError = PQresultStatus(P->res);
+                THROW(SQLException, "%s", PQresultErrorMessage(P->res));
+        }
+        P->res = PQexecPrepared(P->db, P->stmt, P->paramCount, (const char **)P->paramValues, P->paramLengths, P->paramFormats, P->resultFormat);
         P->lastError = PQresultStatus(P->res);
         if (P->lastError == PGRES_TUPLES_OK)
                 return ResultSet_new(PostgresqlResultSet_new(P->res, P->maxRows), (Rop_T)&postgresqlrops);
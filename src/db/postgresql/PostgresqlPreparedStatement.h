@@ -24,13 +24,15 @@
 #ifndef POSTGRESQLPREPAREDSTATEMENT_INCLUDED
 #define POSTGRESQLPREPAREDSTATEMENT_INCLUDED
 #define T PreparedStatementDelegate_T
-T PostgresqlPreparedStatement_new(PGconn *db, int maxRows, char *stmt, int paramCount);
+T PostgresqlPreparedStatement_new(ConnectionDelegate_T delegate, PGconn *db, int maxRows, int fetchSize, char *stmt, int paramCount, const int *lists, int listCount);
 void PostgresqlPreparedStatement_free(T *P);
 void PostgresqlPreparedStatement_setString(T P, int parameterIndex, const char *x);
 void PostgresqlPreparedStatement_setInt(T P, int parameterIndex, int x);
 void PostgresqlPreparedStatement_setLLong(T P, int parameterIndex, long long int x);
 void PostgresqlPreparedStatement_setDouble(T P, int parameterIndex, double x);
 void PostgresqlPreparedStatement_setBlob(T P, int parameterIndex, const void *x, int size);
+void PostgresqlPreparedStatement_setLLongArray(T P, int parameterIndex, const long long int *x, int count);
+void PostgresqlPreparedStatement_setStringArray(T P, int parameterIndex, const char **x, int count);
 void PostgresqlPreparedStatement_execute(T P);
 ResultSet_T PostgresqlPreparedStatement_executeQuery(T P);
 #undef T
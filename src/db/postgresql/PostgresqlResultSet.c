@@ -26,8 +26,13 @@
 #include "Config.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <float.h>
+#include <time.h>
+#include <math.h>
+#include <limits.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <libpq-fe.h>
 
@@ -55,21 +60,66 @@ const struct Rop_T postgresqlrops = {
         PostgresqlResultSet_getColumnSize,
         PostgresqlResultSet_getString,
         PostgresqlResultSet_getBlob,
+        NULL,
+        PostgresqlResultSet_isnull,
+        PostgresqlResultSet_getInt,
+        PostgresqlResultSet_getLLong,
+        PostgresqlResultSet_getDouble,
+        PostgresqlResultSet_fetchBatch,
+        PostgresqlResultSet_getColumnType
 };
 
+typedef struct column_t {
+        char text[64];
+} *column_t;
+
 #define T ResultSetDelegate_T
 struct T {
+        int binary;
         int maxRows;
         int currentRow;
         int columnCount;
         int rowCount;
+        int rows;
+        int done;
+        int cancel;
         PGresult *res;
+        PGconn *db;
+        T *stream;
+        column_t columns;
 };
 
 #define TEST_INDEX \
         int i; assert(R); i = columnIndex - 1; if (R->columnCount <= 0 || \
         i < 0 || i >= R->columnCount) { THROW(SQLException, "Column index is out of range");}
 
+/* Type OIDs from the server's catalog/pg_type.h */
+#define BOOLOID 16
+#define BYTEAOID 17
+#define CHAROID 18
+#define NAMEOID 19
+#define INT8OID 20
+#define INT2OID 21
+#define INT4OID 23
+#define TEXTOID 25
+#define OIDOID 26
+#define JSONOID 114
+#define FLOAT4OID 700
+#define FLOAT8OID 701
+#define BPCHAROID 1042
+#define VARCHAROID 1043
+#define TIMESTAMPOID 1114
+
+/* Seconds from the Unix epoch to the Postgres epoch, 2000-01-01 */
+#define POSTGRES_EPOCH 946684800LL
+
+/* Result status of a row in single-row mode or of a chunk of rows in chunked mode */
+#ifdef LIBPQ_HAS_CHUNK_MODE
+#define ISROWS(S) ((S) == PGRES_SINGLE_TUPLE || (S) == PGRES_TUPLES_CHUNK)
+#else
+#define ISROWS(S) ((S) == PGRES_SINGLE_TUPLE)
+#endif
+
 #define ISFIRSTOCTDIGIT(CH) ((CH) >= '0' && (CH) <= '3')
 #define ISOCTDIGIT(CH) ((CH) >= '0' && (CH) <= '7')
 #define OCTVAL(CH) ((CH) - '0')
@@ -88,27 +138,9 @@ static inline const void *unescape_bytea(uchar_t *s, int len, int *r) {
         assert(s);
         register int i, j;
         if (s[0] == '\\' && s[1] == 'x') { // bytea hex format
-                static const uchar_t hex[128] = {
-                        0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                        0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                        0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                        0,  1,  2,  3,  4,  5,  6, 7, 8, 9, 0, 0, 0, 0, 0, 0,
-                        0, 10, 11, 12, 13, 14, 15, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                        0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                        0, 10, 11, 12, 13, 14, 15, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                        0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-                };
-                for (i = 0, j = 2; j < len; j++) {
-                        /*
-                         According to the doc, whitespace between hex pairs are allowed. Blarg!!
-                         */
-                        if (isxdigit(s[j])) {
-                                s[i] = hex[s[j]] << 4;
-                                s[i] |= hex[s[j + 1]];
-                                i++;
-                                j++;
-                        }
-                }
+                // According to the doc, whitespace between hex pairs are allowed. Blarg!!
+                i = Str_decodeHex(s, (const char *)s + 2, len - 2);
+                j = len;
         } else { // bytea escaped format
                 uchar_t byte;
                 for (i = j = 0; j < len; i++, j++) {
@@ -134,6 +166,169 @@ static inline const void *unescape_bytea(uchar_t *s, int len, int *r) {
 }
 
 
+/* Read a signed integer of n bytes in network byte order */
+static inline long long int readInteger(const uchar_t *p, int n) {
+        unsigned long long int v = 0;
+        for (int i = 0; i < n; i++)
+                v = (v << 8) | p[i];
+        if (n < 8 && (v & (1ULL << (n * 8 - 1))))
+                v |= ~0ULL << (n * 8);
+        return (long long int)v;
+}
+
+
+/* Read an IEEE 754 float4 or float8 in network byte order */
+static inline double readDouble(const uchar_t *p, int n) {
+        if (n == 4) {
+                union { uint32_t i; float f; } u = {.i = (uint32_t)readInteger(p, 4)};
+                return u.f;
+        }
+        union { uint64_t i; double d; } u = {.i = (uint64_t)readInteger(p, 8)};
+        return u.d;
+}
+
+
+/* Format a float4 or float8 as the server does, with the fewest digits that
+ read back as the same value */
+static int formatDouble(char *s, double d, int float4) {
+        if (isnan(d))
+                return snprintf(s, 64, "NaN");
+        if (isinf(d))
+                return snprintf(s, 64, d < 0 ? "-Infinity" : "Infinity");
+        int n, digits = float4 ? FLT_DIG : DBL_DIG;
+        for (;;) {
+                n = snprintf(s, 64, "%.*g", digits, d);
+                double r = strtod(s, NULL);
+                if ((float4 ? (float)r == (float)d : r == d) || digits++ == (float4 ? 9 : 17))
+                        return n;
+        }
+}
+
+
+/* Format a binary timestamp, microseconds since the Postgres epoch, as the
+ server would in ISO DateStyle. Years before year 1 are formatted as BC */
+static int formatTimestamp(char *s, long long int t) {
+        if (t == LLONG_MAX)
+                return snprintf(s, 64, "infinity");
+        if (t == LLONG_MIN)
+                return snprintf(s, 64, "-infinity");
+        struct tm tm;
+        long long int fraction = t % 1000000;
+        time_t seconds = (time_t)(t / 1000000 + POSTGRES_EPOCH);
+        if (fraction < 0) {
+                fraction += 1000000;
+                seconds--;
+        }
+        gmtime_r(&seconds, &tm);
+        int year = tm.tm_year + 1900;
+        int n = snprintf(s, 64, "%04d-%02d-%02d %02d:%02d:%02d", year > 0 ? year : 1 - year, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+        if (fraction) {
+                n += snprintf(s + n, 64 - n, ".%06lld", fraction);
+                while (s[n - 1] == '0')
+                        s[--n] = 0;
+        }
+        if (year <= 0)
+                n += snprintf(s + n, 64 - n, " BC");
+        return n;
+}
+
+
+/* Returns the value of column i in the current row and assign its length to
+ size. In binary format, numbers, booleans and timestamps are formatted as text
+ into the column buffer while text and bytea values are returned as is */
+static const char *getValue(T R, int i, int *size) {
+        const char *value = PQgetvalue(R->res, R->currentRow, i);
+        *size = PQgetlength(R->res, R->currentRow, i);
+        if (R->binary) {
+                char *s = R->columns[i].text;
+                switch (PQftype(R->res, i)) {
+                        case INT2OID:
+                        case INT4OID:
+                        case INT8OID:
+                                *size = snprintf(s, 64, "%lld", readInteger((uchar_t *)value, *size));
+                                return s;
+                        case OIDOID:
+                                *size = snprintf(s, 64, "%lld", readInteger((uchar_t *)value, 4) & 0xffffffffLL);
+                                return s;
+                        case FLOAT4OID:
+                                *size = formatDouble(s, readDouble((uchar_t *)value, 4), true);
+                                return s;
+                        case FLOAT8OID:
+                                *size = formatDouble(s, readDouble((uchar_t *)value, 8), false);
+                                return s;
+                        case BOOLOID:
+                                *size = snprintf(s, 64, "%c", value[0] ? 't' : 'f');
+                                return s;
+                        case TIMESTAMPOID:
+                                *size = formatTimestamp(s, readInteger((uchar_t *)value, 8));
+                                return s;
+                }
+        }
+        return value;
+}
+
+
+/* Read and discard any remaining results so the connection can be used for
+ the next statement */
+static inline void discard(PGconn *db) {
+        PGresult *res;
+        while ((res = PQgetResult(db)))
+                PQclear(res);
+}
+
+
+/* The streamed query is done, the connection can run the next command */
+static inline void endStream(T R) {
+        R->done = true;
+        if (R->stream && *R->stream == R)
+                *R->stream = NULL;
+}
+
+
+/* Stop a streamed query before all rows are read. Outside a transaction the
+ query is cancelled on the server, inside one a cancel would abort the
+ transaction so the remaining rows are read and thrown away instead */
+static void finish(T R) {
+        if (! R->done) {
+                if (R->cancel) {
+                        char error[STRLEN];
+                        PGcancel *cancel = PQgetCancel(R->db);
+                        if (cancel) {
+                                PQcancel(cancel, error, STRLEN);
+                                PQfreeCancel(cancel);
+                        }
+                }
+                discard(R->db);
+                endStream(R);
+        }
+}
+
+
+/* Replace the current rows with the next result of a streamed query */
+static void fetch(T R) {
+        PGresult *res = PQgetResult(R->db);
+        ExecStatusType status = PQresultStatus(res);
+        R->currentRow = -1;
+        R->rowCount = 0;
+        if (ISROWS(status)) {
+                PQclear(R->res);
+                R->res = res;
+                R->rowCount = PQntuples(res);
+        } else {
+                endStream(R);
+                if (! res)
+                        return;
+                discard(R->db);
+                if (status != PGRES_TUPLES_OK) {
+                        PQclear(R->res);
+                        R->res = res;
+                        THROW(SQLException, "%s", PQresultErrorMessage(res));
+                }
+                PQclear(res);
+        }
+}
+
+
 /* ----------------------------------------------------- Protected methods */
 
 
@@ -150,12 +345,79 @@ T PostgresqlResultSet_new(void *res, int maxRows) {
         R->currentRow = -1;
         R->columnCount = PQnfields(R->res);
         R->rowCount = PQntuples(R->res);
+        if ((R->binary = PQbinaryTuples(R->res)))
+                R->columns = CALLOC(R->columnCount, sizeof(struct column_t));
+        return R;
+}
+
+
+/* Create a result set which streams the rows of a query sent with one of the
+ PQsendQuery functions. The rows are read from the server one row, or one chunk
+ of fetchSize rows, at a time as the result set is iterated instead of being
+ loaded into memory at once. The result set takes over the connection until all
+ rows are read or it is finished, and is assigned to the connection's *stream 
+ until then. Must be called right after the query was sent. On error, NULL is
+ returned and the error result is assigned to *error */
+T PostgresqlResultSet_newStream(void *db, int maxRows, int fetchSize, int cancel, void **stream, void **error) {
+        T R;
+        assert(db);
+        assert(stream);
+        assert(error);
+#ifdef LIBPQ_HAS_CHUNK_MODE
+        int streaming = PQsetChunkedRowsMode(db, fetchSize);
+#else
+        int streaming = PQsetSingleRowMode(db);
+#endif
+        if (! streaming) {
+                discard(db);
+                *error = PQmakeEmptyPGresult(db, PGRES_FATAL_ERROR);
+                return NULL;
+        }
+        PGresult *res = PQgetResult(db);
+        ExecStatusType status = PQresultStatus(res);
+        if (! (ISROWS(status) || status == PGRES_TUPLES_OK)) {
+                discard(db);
+                *error = res ? res : PQmakeEmptyPGresult(db, PGRES_FATAL_ERROR);
+                return NULL;
+        }
+        NEW(R);
+        R->db = db;
+        R->res = res;
+        R->maxRows = maxRows;
+        R->cancel = cancel;
+        R->currentRow = -1;
+        R->columnCount = PQnfields(R->res);
+        R->rowCount = PQntuples(R->res);
+        if ((R->binary = PQbinaryTuples(R->res)))
+                R->columns = CALLOC(R->columnCount, sizeof(struct column_t));
+        if (status == PGRES_TUPLES_OK) {
+                discard(db);
+                R->done = true;
+        } else {
+                R->stream = (T *)stream;
+                *R->stream = R;
+        }
         return R;
 }
 
 
+/* Stop a streamed query so the connection can run another command. The result
+ set has no more rows after the rows already fetched */
+void PostgresqlResultSet_finish(T R) {
+        assert(R);
+        finish(R);
+        R->rowCount = 0;
+}
+
+
 void PostgresqlResultSet_free(T *R) {
         assert(R && *R);
+        if ((*R)->db) {
+                finish(*R);
+                PQclear((*R)->res);
+        }
+        if ((*R)->columns)
+                FREE((*R)->columns);
         FREE(*R);
 }
 
@@ -179,23 +441,39 @@ const char *PostgresqlResultSet_getColumnName(T R, int column) {
 
 int PostgresqlResultSet_next(T R) {
         assert(R);
+        if (R->db) {
+                if (R->maxRows && (R->rows >= R->maxRows)) {
+                        finish(R);
+                        return false;
+                }
+                while (++R->currentRow >= R->rowCount) {
+                        if (R->done)
+                                return false;
+                        fetch(R);
+                }
+                R->rows++;
+                return true;
+        }
         return (! ((R->currentRow++ >= (R->rowCount - 1)) || (R->maxRows && (R->currentRow >= R->maxRows))));
 }
 
 
 long PostgresqlResultSet_getColumnSize(T R, int columnIndex) {
+        int size;
         TEST_INDEX
         if (PQgetisnull(R->res, R->currentRow, i)) 
                 return 0; 
-        return PQgetlength(R->res, R->currentRow, i);
+        getValue(R, i, &size);
+        return size;
 }
 
 
 const char *PostgresqlResultSet_getString(T R, int columnIndex) {
+        int size;
         TEST_INDEX
         if (PQgetisnull(R->res, R->currentRow, i)) 
                 return NULL; 
-        return PQgetvalue(R->res, R->currentRow, i);
+        return getValue(R, i, &size);
 }
 
 
@@ -219,14 +497,139 @@ const char *PostgresqlResultSet_getString(T R, int columnIndex) {
  * we instead unescape the buffer retrieved via PQgetvalue 'in-place'. This should 
  * be safe as unescape will only modify internal bytes in the buffer and not change
  * the buffer pointer. See also unescape_bytea() above.
+ *
+ * Prepared statements whose columns all have types decoded by this result set
+ * fetch their result in binary format instead, see PostgresqlResultSet_decodes(),
+ * and a bytea value is then returned as is.
  */
 const void *PostgresqlResultSet_getBlob(T R, int columnIndex, int *size) {
         TEST_INDEX
         if (PQgetisnull(R->res, R->currentRow, i)) 
                 return NULL; 
+        if (R->binary)
+                return getValue(R, i, size);
         return unescape_bytea((uchar_t*)PQgetvalue(R->res, R->currentRow, i), PQgetlength(R->res, R->currentRow, i), size);
 }
 
+
+int PostgresqlResultSet_isnull(T R, int columnIndex) {
+        TEST_INDEX
+        return PQgetisnull(R->res, R->currentRow, i);
+}
+
+
+/* Numbers are read as sent in binary format, otherwise parsed from text */
+int PostgresqlResultSet_getInt(T R, int columnIndex) {
+        long long int l = PostgresqlResultSet_getLLong(R, columnIndex);
+        if (l < INT_MIN || l > INT_MAX)
+                THROW(SQLException, "NumberFormatException: For input string %lld -- Numerical result out of range", l);
+        return (int)l;
+}
+
+
+long long int PostgresqlResultSet_getLLong(T R, int columnIndex) {
+        TEST_INDEX
+        if (PQgetisnull(R->res, R->currentRow, i))
+                return 0;
+        if (R->binary) {
+                const uchar_t *value = (uchar_t *)PQgetvalue(R->res, R->currentRow, i);
+                switch (PQftype(R->res, i)) {
+                        case INT2OID: return readInteger(value, 2);
+                        case INT4OID: return readInteger(value, 4);
+                        case INT8OID: return readInteger(value, 8);
+                        case FLOAT4OID: return (long long int)readDouble(value, 4);
+                        case FLOAT8OID: return (long long int)readDouble(value, 8);
+                }
+        }
+        return Str_parseLLong(PostgresqlResultSet_getString(R, columnIndex));
+}
+
+
+double PostgresqlResultSet_getDouble(T R, int columnIndex) {
+        TEST_INDEX
+        if (PQgetisnull(R->res, R->currentRow, i))
+                return 0.0;
+        if (R->binary) {
+                const uchar_t *value = (uchar_t *)PQgetvalue(R->res, R->currentRow, i);
+                switch (PQftype(R->res, i)) {
+                        case INT2OID: return (double)readInteger(value, 2);
+                        case INT4OID: return (double)readInteger(value, 4);
+                        case INT8OID: return (double)readInteger(value, 8);
+                        case FLOAT4OID: return readDouble(value, 4);
+                        case FLOAT8OID: return readDouble(value, 8);
+                }
+        }
+        return Str_parseDouble(PostgresqlResultSet_getString(R, columnIndex));
+}
+
+
+int PostgresqlResultSet_fetchBatch(T R, int maxRows, RowBuffer_T B) {
+        int rows = 0, size;
+        assert(R);
+        while (rows < maxRows && PostgresqlResultSet_next(R)) {
+                for (int i = 0; i < R->columnCount; i++) {
+                        if (PQgetisnull(R->res, R->currentRow, i)) {
+                                RowBuffer_append(B, NULL, 0);
+                        } else {
+                                const char *value = getValue(R, i, &size);
+                                RowBuffer_append(B, value, size);
+                        }
+                }
+                rows++;
+        }
+        return rows;
+}
+
+
+int PostgresqlResultSet_getColumnType(T R, int columnIndex) {
+        TEST_INDEX
+        switch (PQftype(R->res, i)) {
+                case INT2OID:
+                case INT4OID:
+                case INT8OID: return ColumnType_Integer;
+                case FLOAT4OID:
+                case FLOAT8OID: return ColumnType_Real;
+                case BYTEAOID: return ColumnType_Blob;
+        }
+        return ColumnType_Text;
+}
+
+/* Returns true if every column in the statement description has a type with
+ a binary format decoded by this result set. Other types, such as numeric, are
+ fetched as text. A timestamp is only decoded if sent as a 64-bit integer and 
+ the server formats dates in ISO style. A timestamptz is formatted in the session
+ time zone by the server and is always fetched as text */
+int PostgresqlResultSet_decodes(void *db, void *description) {
+        assert(db);
+        assert(description);
+        for (int i = 0; i < PQnfields(description); i++) {
+                switch (PQftype(description, i)) {
+                        case BOOLOID:
+                        case BYTEAOID:
+                        case CHAROID:
+                        case NAMEOID:
+                        case INT8OID:
+                        case INT2OID:
+                        case INT4OID:
+                        case TEXTOID:
+                        case OIDOID:
+                        case JSONOID:
+                        case FLOAT4OID:
+                        case FLOAT8OID:
+                        case BPCHAROID:
+                        case VARCHAROID:
+                                break;
+                        case TIMESTAMPOID:
+                                if (IS(PQparameterStatus(db, "integer_datetimes"), "on") && Str_startsWith(PQparameterStatus(db, "DateStyle"), "ISO"))
+                                        break;
+                                return false;
+                        default:
+                                return false;
+                }
+        }
+        return true;
+}
+
 #ifdef PACKAGE_PROTECTED
 #pragma GCC visibility pop
 #endif
@@ -25,6 +25,8 @@
 #define POSTGRESQLRESULTSET_INCLUDED
 #define T ResultSetDelegate_T
 T PostgresqlResultSet_new(void *stmt, int maxRows);
+T PostgresqlResultSet_newStream(void *db, int maxRows, int fetchSize, int cancel, void **stream, void **error);
+void PostgresqlResultSet_finish(T R);
 void PostgresqlResultSet_free(T *R);
 int PostgresqlResultSet_getColumnCount(T R);
 const char *PostgresqlResultSet_getColumnName(T R, int column);
@@ -32,5 +34,12 @@ int PostgresqlResultSet_next(T R);
 long PostgresqlResultSet_getColumnSize(T R, int columnIndex);
 const char *PostgresqlResultSet_getString(T R, int columnIndex);
 const void *PostgresqlResultSet_getBlob(T R, int columnIndex, int *size);
+int PostgresqlResultSet_isnull(T R, int columnIndex);
+int PostgresqlResultSet_getInt(T R, int columnIndex);
+long long int PostgresqlResultSet_getLLong(T R, int columnIndex);
+double PostgresqlResultSet_getDouble(T R, int columnIndex);
+int PostgresqlResultSet_fetchBatch(T R, int maxRows, RowBuffer_T B);
+int PostgresqlResultSet_getColumnType(T R, int columnIndex);
+int PostgresqlResultSet_decodes(void *db, void *description);
 #undef T
 #endif
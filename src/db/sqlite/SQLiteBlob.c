@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+
+
+#include "Config.h"
+
+#include <stdio.h>
+#include <sqlite3.h>
+
+#include "BlobDelegate.h"
+#include "SQLiteBlob.h"
+
+
+/**
+ * Implementation of the Blob/Delegate interface for SQLite using
+ * SQLite's incremental blob I/O.
+ *
+ * @file
+ */
+
+
+/* ------------------------------------------------------------- Definitions */
+
+
+const struct Bop_T sqlite3bops = {
+	"sqlite",
+        SQLiteBlob_free,
+        SQLiteBlob_getSize,
+        SQLiteBlob_read,
+        SQLiteBlob_write,
+        SQLiteBlob_reopen,
+        SQLiteBlob_close
+};
+
+#define T BlobDelegate_T
+struct T {
+        sqlite3 *db;
+        sqlite3_blob *blob;
+};
+
+
+/* ----------------------------------------------------- Protected methods */
+
+
+#ifdef PACKAGE_PROTECTED
+#pragma GCC visibility push(hidden)
+#endif
+
+T SQLiteBlob_new(sqlite3 *db, void *blob) {
+	T B;
+	assert(db);
+	assert(blob);
+	NEW(B);
+        B->db = db;
+	B->blob = blob;
+	return B;
+}
+
+
+void SQLiteBlob_free(T *B) {
+	assert(B && *B);
+        SQLiteBlob_close(*B);
+	FREE(*B);
+}
+
+
+int SQLiteBlob_getSize(T B) {
+        assert(B);
+        return sqlite3_blob_bytes(B->blob);
+}
+
+
+int SQLiteBlob_read(T B, void *buffer, int size, int offset) {
+        assert(B);
+        int bytes = sqlite3_blob_bytes(B->blob);
+        if (offset >= bytes)
+                return 0;
+        if (size > bytes - offset)
+                size = bytes - offset;
+        if (sqlite3_blob_read(B->blob, buffer, size, offset) != SQLITE_OK)
+                THROW(SQLException, "%s", sqlite3_errmsg(B->db));
+        return size;
+}
+
+
+void SQLiteBlob_write(T B, const void *buffer, int size, int offset) {
+        assert(B);
+        if (sqlite3_blob_write(B->blob, buffer, size, offset) != SQLITE_OK)
+                THROW(SQLException, "%s", sqlite3_errmsg(B->db));
+}
+
+
+void SQLiteBlob_reopen(T B, long long int rowid) {
+        assert(B);
+#if SQLITE_VERSION_NUMBER >= 3007004
+        if (sqlite3_blob_reopen(B->blob, rowid) != SQLITE_OK)
+                THROW(SQLException, "%s", sqlite3_errmsg(B->db));
+#else
+        THROW(SQLException, "Blob_reopen is not supported by your sqlite3 version, please consider upgrading sqlite3");
+#endif
+}
+
+
+void SQLiteBlob_close(T B) {
+        assert(B);
+        if (B->blob) {
+                sqlite3_blob_close(B->blob);
+                B->blob = NULL;
+        }
+}
+
+#ifdef PACKAGE_PROTECTED
+#pragma GCC visibility pop
+#endif
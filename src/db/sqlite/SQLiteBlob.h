@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) Tildeslash Ltd. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ *
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.
+ */
+#ifndef SQLITEBLOB_INCLUDED
+#define SQLITEBLOB_INCLUDED
+#define T BlobDelegate_T
+T SQLiteBlob_new(sqlite3 *db, void *blob);
+void SQLiteBlob_free(T *B);
+int SQLiteBlob_getSize(T B);
+int SQLiteBlob_read(T B, void *buffer, int size, int offset);
+void SQLiteBlob_write(T B, const void *buffer, int size, int offset);
+void SQLiteBlob_reopen(T B, long long int rowid);
+void SQLiteBlob_close(T B);
+#undef T
+#endif
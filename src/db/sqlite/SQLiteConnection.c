@@ -33,9 +33,11 @@
 #include "StringBuffer.h"
 #include "system/Time.h"
 #include "PreparedStatement.h"
+#include "Blob.h"
 #include "SQLiteResultSet.h"
-#include "SQLitePreparedStatement.h"
 #include "ConnectionDelegate.h"
+#include "SQLitePreparedStatement.h"
+#include "SQLiteBlob.h"
 #include "SQLiteConnection.h"
 
 
@@ -65,41 +67,167 @@ const struct Cop_T sqlite3cops = {
         SQLiteConnection_execute,
         SQLiteConnection_executeQuery,
         SQLiteConnection_prepareStatement,
-        SQLiteConnection_getLastError
+        SQLiteConnection_getLastError,
+        SQLiteConnection_openBlob,
+        SQLiteConnection_onsweep,
+        SQLiteConnection_onreaper,
+        SQLiteConnection_mapStatistics
 };
 
+/* Number of statements cached per connection by executeQuery */
+#define SQLITE_STATEMENT_CACHE_SIZE 16
+
+/* Size of the statistics hash table and max number of SQL statements in the statistics */
+#define SQLITE_STATISTICS_BUCKETS 256
+#define SQLITE_STATISTICS_MAX 4096
+
+/* A write job queued for the single writer. Jobs are allocated on the stack
+ of the submitting thread, which waits until the job is done */
+typedef struct SQLiteJob_S {
+        const char *sql;        // SQL to execute, or
+        sqlite3_stmt *stmt;     // prepared statement to step on the writer
+        int done;
+        int status;
+        int changes;
+        long long int rowid;
+        char *error;
+        struct SQLiteJob_S *next;
+} *SQLiteJob_T;
+
+/* The writer shared by all connections to the same database in single-writer mode */
+typedef struct SQLiteWriter_S {
+        char *path;
+        int refcount;
+        int stop;
+        sqlite3 *db;
+        SQLiteBusy_T busy;
+        Mutex_T mutex;          // Protects the job queue
+        Mutex_T lock;           // Held while a batch or an explicit transaction use db
+        Sem_T queued;
+        Sem_T done;
+        Thread_T thread;
+        SQLiteJob_T head;
+        SQLiteJob_T tail;
+        struct SQLiteWriter_S *next;
+} *SQLiteWriter_T;
+
+/* Statement counters aggregated per SQL text */
+typedef struct SQLiteStatement_S {
+        char *sql;
+        long long int executions;
+        long long int counters[SQL_STATUS_COUNT];
+        struct SQLiteStatement_S *next;
+} *SQLiteStatement_T;
+
+/* Statistics shared by all connections to the same database */
+typedef struct SQLiteStatistics_S {
+        char *path;
+        int refcount;
+        int size;
+        Mutex_T mutex;
+        SQLiteStatement_T table[SQLITE_STATISTICS_BUCKETS];
+        struct SQLiteStatistics_S *next;
+} *SQLiteStatistics_T;
+
 #define T ConnectionDelegate_T
 struct T {
         URL_T url;
 	sqlite3 *db;
 	int maxRows;
-	int timeout;
 	int lastError;
+        SQLiteBusy_T busy;
+        SQLiteWriter_T writer;
+        SQLiteStatistics_T statistics;
+        int inTransaction;
+        int locked;             // Number of result sets holding the writer lock outside a transaction
+        int changes;
+        long long int rowid;
+        char *error;
+        long long int ticks;
+        struct {
+                char *sql;
+                sqlite3_stmt *stmt;
+                long long int used;
+        } cache[SQLITE_STATEMENT_CACHE_SIZE];
         StringBuffer_T sb;
 };
 
 extern const struct Rop_T sqlite3rops;
 extern const struct Pop_T sqlite3pops;
+extern const struct Bop_T sqlite3bops;
+
+/* Memory map size used by the high-concurrency preset (256 MB) */
+#define SQLITE_HIGH_CONCURRENCY_MMAP_SIZE 268435456LL
+
+/* Writers in single-writer mode and statement statistics, one per database path */
+static SQLiteWriter_T writers = NULL;
+static SQLiteStatistics_T statistics = NULL;
+static Mutex_T registryMutex = PTHREAD_MUTEX_INITIALIZER;
 
 
 /* ------------------------------------------------------- Private methods */
 
 
+/* Return true or false if the boolean URL property name is set, otherwise the given default value */
+static inline int getOption(URL_T url, const char *name, int defaultValue) {
+        const char *value = URL_getParameter(url, name);
+        return value ? IS(value, "true") : defaultValue;
+}
+
+
+/* URL properties which are connection options and not pragmas */
+static inline int isOption(const char *name) {
+        static const char *options[] = {"heap_limit", "shared-cache", "no-mutex", "read-only", "uri", "high-concurrency", "single-writer", "statistics", "reaper-checkpoint", NULL};
+        for (int i = 0; options[i]; i++)
+                if (IS(name, options[i]))
+                        return true;
+        return false;
+}
+
+
+static int doOpen(URL_T url, const char *path, int flags, sqlite3 **db) {
+#if SQLITE_VERSION_NUMBER >= 3005000
+#ifdef SQLITE_OPEN_URI
+        if (getOption(url, "uri", false)) {
+                char *uri = Str_cat("file:%s", path);
+                int status = sqlite3_open_v2(uri, db, flags | SQLITE_OPEN_URI, NULL);
+                FREE(uri);
+                return status;
+        }
+#endif
+        return sqlite3_open_v2(path, db, flags, NULL);
+#else
+        return sqlite3_open(path, db);
+#endif
+}
+
+
 static sqlite3 *doConnect(URL_T url, char **error) {
-        int status;
 	sqlite3 *db;
+        int flags = 0;
         const char *path = URL_getPath(url);
         if (! path) {
                 *error = Str_dup("no database specified in URL");
                 return NULL;
         }
-        /* Shared cache mode help reduce database lock problems if libzdb is used with many threads */
 #if SQLITE_VERSION_NUMBER >= 3005000
-        status = sqlite3_open_v2(path, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_SHAREDCACHE, NULL);
-#else
-        status = sqlite3_open(path, &db);
+        int highConcurrency = getOption(url, "high-concurrency", false);
+        flags = getOption(url, "read-only", false) ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+        /* Shared cache mode help reduce memory usage, but serialize readers on table locks. 
+         It is on by default for backward compatibility, except in high-concurrency and single-writer mode */
+        if (getOption(url, "shared-cache", ! (highConcurrency || getOption(url, "single-writer", false))))
+                flags |= SQLITE_OPEN_SHAREDCACHE;
+#ifdef SQLITE_OPEN_PRIVATECACHE
+        else
+                flags |= SQLITE_OPEN_PRIVATECACHE;
 #endif
-        if (SQLITE_OK != status) {
+#ifdef SQLITE_OPEN_NOMUTEX
+        /* A Connection is only used by one thread at the time so SQLite's own mutexing can be turned off */
+        if (getOption(url, "no-mutex", highConcurrency))
+                flags |= SQLITE_OPEN_NOMUTEX;
+#endif
+#endif
+        if (SQLITE_OK != doOpen(url, path, flags, &db)) {
                 *error = Str_cat("cannot open database '%s' -- %s", path, sqlite3_errmsg(db));
                 sqlite3_close(db);
                 return NULL;
@@ -108,31 +236,55 @@ static sqlite3 *doConnect(URL_T url, char **error) {
 }
 
 
+/* SQLite busy handler. Called when the database is locked by another connection.
+ Return non-zero to try again or 0 to give up and return SQLITE_BUSY */
+static int busyHandler(void *busy, int count) {
+        return sqlite_backoff(busy, count);
+}
+
+
 static inline void executeSQL(T C, const char *sql) {
 #if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
         C->lastError = sqlite3_blocking_exec(C->db, sql, NULL, NULL, NULL);
 #else
-        EXEC_SQLITE(C->lastError, sqlite3_exec(C->db, sql, NULL, NULL, NULL), C->timeout);
+        EXEC_SQLITE(C->lastError, sqlite3_exec(C->db, sql, NULL, NULL, NULL), &C->busy);
 #endif
 }
 
 
-static int setProperties(T C, char **error) {
-        const char **properties = URL_getParameterNames(C->url);
+/* Append PRAGMA statements for the URL properties which are not connection options */
+static void appendPragmas(URL_T url, StringBuffer_T sb) {
+        const char **properties = URL_getParameterNames(url);
         if (properties) {
-                StringBuffer_clear(C->sb);
-                for (int i = 0; properties[i]; i++) {
-                        if (IS(properties[i], "heap_limit")) // There is no PRAGMA for heap limit as of sqlite-3.7.0, so we make it a configurable property using "heap_limit" [kB]
-                                #if defined(HAVE_SQLITE3_SOFT_HEAP_LIMIT64)
-                                sqlite3_soft_heap_limit64(Str_parseInt(URL_getParameter(C->url, properties[i])) * 1024);
-                                #elif defined(HAVE_SQLITE3_SOFT_HEAP_LIMIT)
-                                sqlite3_soft_heap_limit(Str_parseInt(URL_getParameter(C->url, properties[i])) * 1024);
-                                #else
-                                DEBUG("heap_limit not supported by your sqlite3 version, please consider upgrading sqlite3\n");
-                                #endif
-                        else
-                                StringBuffer_append(C->sb, "PRAGMA %s = %s; ", properties[i], URL_getParameter(C->url, properties[i]));
+                /* High-concurrency preset. Pragmas given in the URL are appended after and take precedence */
+                if (getOption(url, "high-concurrency", false)) {
+                        if (! getOption(url, "read-only", false) && ! getOption(url, "single-writer", false))
+                                StringBuffer_append(sb, "PRAGMA journal_mode = WAL; ");
+                        StringBuffer_append(sb, "PRAGMA synchronous = NORMAL; PRAGMA mmap_size = %lld; ", SQLITE_HIGH_CONCURRENCY_MMAP_SIZE);
                 }
+                for (int i = 0; properties[i]; i++)
+                        if (! isOption(properties[i]))
+                                StringBuffer_append(sb, "PRAGMA %s = %s; ", properties[i], URL_getParameter(url, properties[i]));
+        }
+}
+
+
+static int setProperties(T C, char **error) {
+        const char *heapLimit = URL_getParameter(C->url, "heap_limit");
+        if (heapLimit) // There is no PRAGMA for heap limit as of sqlite-3.7.0, so we make it a configurable property using "heap_limit" [kB]
+                #if defined(HAVE_SQLITE3_SOFT_HEAP_LIMIT64)
+                sqlite3_soft_heap_limit64(Str_parseInt(heapLimit) * 1024);
+                #elif defined(HAVE_SQLITE3_SOFT_HEAP_LIMIT)
+                sqlite3_soft_heap_limit(Str_parseInt(heapLimit) * 1024);
+                #else
+                DEBUG("heap_limit not supported by your sqlite3 version, please consider upgrading sqlite3\n");
+                #endif
+        StringBuffer_clear(C->sb);
+        appendPragmas(C->url, C->sb);
+        /* In single-writer mode all writes go through the writer and the connection's own handle is only used for queries */
+        if (C->writer)
+                StringBuffer_append(C->sb, "PRAGMA query_only = 1; ");
+        if (StringBuffer_length(C->sb)) {
                 executeSQL(C, StringBuffer_toString(C->sb));
                 if (C->lastError != SQLITE_OK) {
                         *error = Str_cat("unable to set database pragmas -- %s", sqlite3_errmsg(C->db));
@@ -143,6 +295,461 @@ static int setProperties(T C, char **error) {
 }
 
 
+/* Return the statistics for the database in url, created if this is the first connection */
+static SQLiteStatistics_T getStatistics(URL_T url) {
+        SQLiteStatistics_T S;
+        const char *path = URL_getPath(url);
+        LOCK(registryMutex)
+        {
+                for (S = statistics; S; S = S->next)
+                        if (IS(S->path, path))
+                                break;
+                if (S) {
+                        S->refcount++;
+                } else {
+                        NEW(S);
+                        S->refcount = 1;
+                        S->path = Str_dup(path);
+                        Mutex_init(S->mutex);
+                        S->next = statistics;
+                        statistics = S;
+                }
+        }
+        END_LOCK;
+        return S;
+}
+
+
+static void releaseStatistics(SQLiteStatistics_T *S) {
+        LOCK(registryMutex)
+        {
+                if (--(*S)->refcount == 0) {
+                        SQLiteStatistics_T *s = &statistics;
+                        while (*s != *S)
+                                s = &(*s)->next;
+                        *s = (*S)->next;
+                        for (int i = 0; i < SQLITE_STATISTICS_BUCKETS; i++) {
+                                for (SQLiteStatement_T e = (*S)->table[i], next; e; e = next) {
+                                        next = e->next;
+                                        FREE(e->sql);
+                                        FREE(e);
+                                }
+                        }
+                        Mutex_destroy((*S)->mutex);
+                        FREE((*S)->path);
+                        FREE(*S);
+                }
+        }
+        END_LOCK;
+        *S = NULL;
+}
+
+
+/* FNV-1a hash of the SQL text */
+static inline unsigned int hash(const char *sql) {
+        unsigned int h = 2166136261U;
+        while (*sql)
+                h = (h ^ (unsigned char)*sql++) * 16777619U;
+        return h % SQLITE_STATISTICS_BUCKETS;
+}
+
+
+/* Add the counters of the statement's last execution to the statistics, if enabled, and
+ reset them. Called before a statement is executed again and before it is finalized */
+static void collect(T C, sqlite3_stmt *stmt) {
+        long long int counters[SQL_STATUS_COUNT];
+        for (int i = 0; i < SQL_STATUS_COUNT; i++)
+                counters[i] = sqlite_status(stmt, i, true);
+#ifdef SQLITE_STMTSTATUS_RUN
+        int executions = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_RUN, true);
+#else
+        int executions = 1;
+#endif
+        if (C->statistics && executions > 0) {
+                const char *sql = sqlite3_sql(stmt);
+                SQLiteStatistics_T S = C->statistics;
+                LOCK(S->mutex)
+                {
+                        SQLiteStatement_T e;
+                        unsigned int i = hash(sql);
+                        for (e = S->table[i]; e; e = e->next)
+                                if (IS(e->sql, sql))
+                                        break;
+                        if (! e && S->size < SQLITE_STATISTICS_MAX) {
+                                NEW(e);
+                                e->sql = Str_dup(sql);
+                                e->next = S->table[i];
+                                S->table[i] = e;
+                                S->size++;
+                        }
+                        if (e) {
+                                e->executions += executions;
+                                for (int k = 0; k < SQL_STATUS_COUNT; k++)
+                                        e->counters[k] = (counters[k] < 0) ? -1 : e->counters[k] + counters[k];
+                        }
+                }
+                END_LOCK;
+        }
+}
+
+
+/* Return the cached statement for sql or NULL if not found. A cached statement is 
+ reset when its ResultSet is closed and can be executed again without being prepared */
+static sqlite3_stmt *getCachedStatement(T C, const char *sql) {
+        for (int i = 0; i < SQLITE_STATEMENT_CACHE_SIZE; i++) {
+                if (C->cache[i].sql && IS(C->cache[i].sql, sql)) {
+                        C->cache[i].used = ++C->ticks;
+                        return C->cache[i].stmt;
+                }
+        }
+        return NULL;
+}
+
+
+/* Cache the statement, replacing the least recently used statement if the cache is full */
+static void cacheStatement(T C, const char *sql, sqlite3_stmt *stmt) {
+        int lru = 0;
+        for (int i = 1; i < SQLITE_STATEMENT_CACHE_SIZE; i++)
+                if (C->cache[i].used < C->cache[lru].used)
+                        lru = i;
+        if (C->cache[lru].stmt) {
+                collect(C, C->cache[lru].stmt);
+                sqlite3_finalize(C->cache[lru].stmt);
+                FREE(C->cache[lru].sql);
+        }
+        C->cache[lru].sql = Str_dup(sql);
+        C->cache[lru].stmt = stmt;
+        C->cache[lru].used = ++C->ticks;
+}
+
+
+static void clearCache(T C) {
+        for (int i = 0; i < SQLITE_STATEMENT_CACHE_SIZE; i++) {
+                if (C->cache[i].stmt) {
+                        collect(C, C->cache[i].stmt);
+                        sqlite3_finalize(C->cache[i].stmt);
+                        FREE(C->cache[i].sql);
+                        C->cache[i].stmt = NULL;
+                }
+        }
+}
+
+
+/* --------------------------------------------------------- Single writer */
+
+
+/* Run a job on the writer's database. Called with the writer lock held */
+static void runJob(SQLiteWriter_T W, SQLiteJob_T job) {
+        if (job->sql) {
+                job->status = sqlite3_exec(W->db, job->sql, NULL, NULL, NULL);
+        } else {
+                job->status = sqlite3_step(job->stmt);
+                sqlite3_reset(job->stmt);
+        }
+        job->changes = sqlite3_changes(W->db);
+        job->rowid = sqlite3_last_insert_rowid(W->db);
+        if (job->status != SQLITE_OK && job->status != SQLITE_DONE && job->status != SQLITE_ROW)
+                job->error = Str_dup(sqlite3_errmsg(W->db));
+}
+
+
+/* Run a batch of jobs in one transaction. Each job runs in its own savepoint
+ so a failed job is rolled back without affecting the other jobs in the batch */
+static void runBatch(SQLiteWriter_T W, SQLiteJob_T batch) {
+        int status = sqlite3_exec(W->db, "BEGIN IMMEDIATE TRANSACTION;", NULL, NULL, NULL);
+        if (status == SQLITE_OK) {
+                for (SQLiteJob_T job = batch; job; job = job->next) {
+                        sqlite3_exec(W->db, "SAVEPOINT job;", NULL, NULL, NULL);
+                        runJob(W, job);
+                        if (job->error)
+                                sqlite3_exec(W->db, "ROLLBACK TO job;", NULL, NULL, NULL);
+                        sqlite3_exec(W->db, "RELEASE job;", NULL, NULL, NULL);
+                }
+                status = sqlite3_exec(W->db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+        }
+        if (status != SQLITE_OK) {
+                const char *error = sqlite3_errmsg(W->db);
+                for (SQLiteJob_T job = batch; job; job = job->next) {
+                        if (! job->error) {
+                                job->status = status;
+                                job->error = Str_dup(error);
+                        }
+                }
+                if (! sqlite3_get_autocommit(W->db))
+                        sqlite3_exec(W->db, "ROLLBACK TRANSACTION;", NULL, NULL, NULL);
+        }
+}
+
+
+/* The writer thread. Takes all jobs queued and run them as one batch. Jobs are only
+ taken with the writer lock held, so jobs waiting for an explicit transaction to end
+ stay queued and can time out, see submitJob() */
+static void *doWrite(void *args) {
+        SQLiteJob_T batch;
+        SQLiteWriter_T W = args;
+        int stop;
+        do {
+                LOCK(W->mutex)
+                {
+                        while (! W->head && ! W->stop)
+                                Sem_wait(W->queued, W->mutex);
+                        stop = W->stop;
+                }
+                END_LOCK;
+                LOCK(W->lock)
+                {
+                        Mutex_lock(W->mutex);
+                        batch = W->head;
+                        W->head = W->tail = NULL;
+                        Mutex_unlock(W->mutex);
+                        if (batch)
+                                runBatch(W, batch);
+                }
+                END_LOCK;
+                if (batch) {
+                        LOCK(W->mutex)
+                        {
+                                for (SQLiteJob_T job = batch; job; job = job->next)
+                                        job->done = true;
+                                Sem_broadcast(W->done);
+                        }
+                        END_LOCK;
+                }
+        } while (batch || ! stop);
+        return NULL;
+}
+
+
+/* Remove a job which is still queued. Called with the queue mutex held. Returns
+ false if the writer thread has already taken the job */
+static int removeJob(SQLiteWriter_T W, SQLiteJob_T job) {
+        SQLiteJob_T previous = NULL;
+        for (SQLiteJob_T j = W->head; j; previous = j, j = j->next) {
+                if (j == job) {
+                        if (previous)
+                                previous->next = job->next;
+                        else
+                                W->head = job->next;
+                        if (W->tail == job)
+                                W->tail = previous;
+                        return true;
+                }
+        }
+        return false;
+}
+
+
+/* Queue a job for the writer thread and wait until it is done. The job waits at most
+ timeout milliseconds, 0 means no limit, to be taken by the writer, which waits while
+ an explicit transaction on another connection holds the writer lock */
+static void submitJob(SQLiteWriter_T W, SQLiteJob_T job, int timeout) {
+        long long int deadline = Time_milli() + timeout;
+        struct timespec wait = {.tv_sec = (time_t)(deadline / 1000), .tv_nsec = (long)(deadline % 1000) * 1000000};
+        LOCK(W->mutex)
+        {
+                if (W->tail)
+                        W->tail->next = job;
+                else
+                        W->head = job;
+                W->tail = job;
+                Sem_signal(W->queued);
+                while (! job->done) {
+                        if (timeout <= 0) {
+                                Sem_wait(W->done, W->mutex);
+                        } else {
+                                Sem_timeWait(W->done, W->mutex, wait);
+                                if (! job->done && Time_milli() >= deadline && removeJob(W, job)) {
+                                        job->status = SQLITE_BUSY;
+                                        job->error = Str_cat("timeout after %d ms waiting for the single writer", timeout);
+                                        break;
+                                }
+                        }
+                }
+        }
+        END_LOCK;
+}
+
+
+static SQLiteWriter_T newWriter(URL_T url, const char *path, char **error) {
+        sqlite3 *db;
+        SQLiteWriter_T W;
+        int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+#ifdef SQLITE_OPEN_FULLMUTEX
+        /* The writer is shared by all connections */
+        flags |= SQLITE_OPEN_FULLMUTEX;
+#endif
+#ifdef SQLITE_OPEN_PRIVATECACHE
+        flags |= SQLITE_OPEN_PRIVATECACHE;
+#endif
+        if (SQLITE_OK != doOpen(url, path, flags, &db)) {
+                *error = Str_cat("cannot open database '%s' -- %s", path, sqlite3_errmsg(db));
+                sqlite3_close(db);
+                return NULL;
+        }
+        NEW(W);
+        W->db = db;
+        W->refcount = 1;
+        W->path = Str_dup(path);
+        W->busy.timeout = SQL_DEFAULT_TIMEOUT;
+        W->busy.seed = (unsigned int)((size_t)W ^ Time_milli());
+        sqlite3_busy_handler(W->db, busyHandler, &W->busy);
+        /* Readers run in parallel with the writer in WAL mode */
+        StringBuffer_T sb = StringBuffer_new("PRAGMA journal_mode = WAL; ");
+        appendPragmas(url, sb);
+        if (SQLITE_OK != sqlite3_exec(W->db, StringBuffer_toString(sb), NULL, NULL, NULL)) {
+                *error = Str_cat("unable to set database pragmas -- %s", sqlite3_errmsg(W->db));
+                StringBuffer_free(&sb);
+                sqlite3_close(W->db);
+                FREE(W->path);
+                FREE(W);
+                return NULL;
+        }
+        StringBuffer_free(&sb);
+        Mutex_init(W->mutex);
+        Mutex_init(W->lock);
+        Sem_init(W->queued);
+        Sem_init(W->done);
+        Thread_create(W->thread, doWrite, W);
+        return W;
+}
+
+
+static void freeWriter(SQLiteWriter_T *W) {
+        LOCK((*W)->mutex)
+        {
+                (*W)->stop = true;
+                Sem_signal((*W)->queued);
+        }
+        END_LOCK;
+        Thread_join((*W)->thread);
+        while (sqlite3_close((*W)->db) == SQLITE_BUSY)
+               Time_usleep(10);
+        Sem_destroy((*W)->queued);
+        Sem_destroy((*W)->done);
+        Mutex_destroy((*W)->mutex);
+        Mutex_destroy((*W)->lock);
+        FREE((*W)->path);
+        FREE(*W);
+}
+
+
+/* Return the writer for the database in url, which is created if this is the first connection */
+static SQLiteWriter_T getWriter(URL_T url, char **error) {
+        SQLiteWriter_T W;
+        const char *path = URL_getPath(url);
+        if (! path) {
+                *error = Str_dup("no database specified in URL");
+                return NULL;
+        }
+        LOCK(registryMutex)
+        {
+                for (W = writers; W; W = W->next)
+                        if (IS(W->path, path))
+                                break;
+                if (W)
+                        W->refcount++;
+                else if ((W = newWriter(url, path, error))) {
+                        W->next = writers;
+                        writers = W;
+                }
+        }
+        END_LOCK;
+        return W;
+}
+
+
+static void releaseWriter(SQLiteWriter_T *W) {
+        LOCK(registryMutex)
+        {
+                if (--(*W)->refcount == 0) {
+                        SQLiteWriter_T *w = &writers;
+                        while (*w != *W)
+                                w = &(*w)->next;
+                        *w = (*W)->next;
+                        freeWriter(W);
+                }
+        }
+        END_LOCK;
+        *W = NULL;
+}
+
+
+/* Lock the writer for this connection. Waits at most the query timeout while a batch or
+ a transaction on another connection holds the lock */
+static int lockWriter(T C) {
+        for (int count = 0; pthread_mutex_trylock(&C->writer->lock) != 0; ) {
+                if (! sqlite_backoff(&C->busy, count++)) {
+                        FREE(C->error);
+                        C->lastError = SQLITE_BUSY;
+                        C->error = Str_cat("timeout after %d ms waiting for the single writer", C->busy.timeout);
+                        return false;
+                }
+        }
+        return true;
+}
+
+
+/* Execute sql or step stmt on the writer. Inside a transaction, or while a result set of this
+ connection holds the writer lock, the statement is executed directly, otherwise it is queued
+ for the writer thread */
+static void executeWrite(T C, const char *sql, sqlite3_stmt *stmt) {
+        struct SQLiteJob_S job = {.sql = sql, .stmt = stmt};
+        FREE(C->error);
+        if (C->inTransaction || C->locked)
+                runJob(C->writer, &job);
+        else
+                submitJob(C->writer, &job, C->busy.timeout);
+        C->lastError = job.status;
+        C->changes = job.changes;
+        C->rowid = job.rowid;
+        C->error = job.error;
+}
+
+
+/* Execute a transaction statement on the writer from a connection holding the writer lock */
+static inline int executeTransaction(T C, const char *sql) {
+        FREE(C->error);
+        C->lastError = sqlite3_exec(C->writer->db, sql, NULL, NULL, NULL);
+        if (C->lastError != SQLITE_OK)
+                C->error = Str_dup(sqlite3_errmsg(C->writer->db));
+        return (C->lastError == SQLITE_OK);
+}
+
+
+/* End an explicit transaction and let the writer thread continue */
+static int endTransaction(T C, const char *sql) {
+        if (! C->inTransaction) {
+                FREE(C->error);
+                C->lastError = SQLITE_ERROR;
+                C->error = Str_cat("cannot %s - no transaction is active", sql);
+                return false;
+        }
+        int success = executeTransaction(C, Str_isEqual(sql, "commit") ? "COMMIT TRANSACTION;" : "ROLLBACK TRANSACTION;");
+        if (! sqlite3_get_autocommit(C->writer->db))
+                sqlite3_exec(C->writer->db, "ROLLBACK TRANSACTION;", NULL, NULL, NULL);
+        C->inTransaction = false;
+        C->writer->busy.timeout = SQL_DEFAULT_TIMEOUT;
+        Mutex_unlock(C->writer->lock);
+        return success;
+}
+
+
+/* Checkpoint the WAL */
+static void checkpoint(sqlite3 *db, int idle) {
+#if SQLITE_VERSION_NUMBER >= 3007006
+        int log, checkpointed;
+#ifdef SQLITE_CHECKPOINT_TRUNCATE
+        int mode = idle ? SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_PASSIVE;
+#else
+        int mode = idle ? SQLITE_CHECKPOINT_RESTART : SQLITE_CHECKPOINT_PASSIVE;
+#endif
+        int status = sqlite3_wal_checkpoint_v2(db, NULL, mode, &log, &checkpointed);
+        if (status != SQLITE_OK && status != SQLITE_BUSY)
+                DEBUG("SQLite: WAL checkpoint failed -- %s\n", sqlite3_errmsg(db));
+#endif
+}
+
+
 /* ----------------------------------------------------- Protected methods */
 
 
@@ -153,14 +760,25 @@ static int setProperties(T C, char **error) {
 T SQLiteConnection_new(URL_T url, char **error) {
 	T C;
         sqlite3 *db;
+        SQLiteWriter_T writer = NULL;
 	assert(url);
         assert(error);
-        if (! (db = doConnect(url, error)))
+        if (getOption(url, "single-writer", false) && ! (writer = getWriter(url, error)))
                 return NULL;
+        if (! (db = doConnect(url, error))) {
+                if (writer)
+                        releaseWriter(&writer);
+                return NULL;
+        }
 	NEW(C);
         C->db = db;
         C->url = url;
-        C->timeout = SQL_DEFAULT_TIMEOUT;
+        C->writer = writer;
+        if (getOption(url, "statistics", false))
+                C->statistics = getStatistics(url);
+        C->busy.timeout = SQL_DEFAULT_TIMEOUT;
+        C->busy.seed = (unsigned int)((size_t)C ^ Time_milli());
+        sqlite3_busy_handler(C->db, busyHandler, &C->busy);
         C->sb = StringBuffer_create(STRLEN);
         if (! setProperties(C, error))
                 SQLiteConnection_free(&C);
@@ -170,17 +788,27 @@ T SQLiteConnection_new(URL_T url, char **error) {
 
 void SQLiteConnection_free(T *C) {
 	assert(C && *C);
+        if ((*C)->busy.waits)
+                DEBUG("SQLite: %lld busy waits, %lld ms waited in total\n", (*C)->busy.waits, (*C)->busy.waited / USEC_PER_MSEC);
+        clearCache(*C);
         while (sqlite3_close((*C)->db) == SQLITE_BUSY)
                Time_usleep(10);
+        if ((*C)->writer) {
+                if ((*C)->inTransaction)
+                        endTransaction(*C, "rollback");
+                releaseWriter(&(*C)->writer);
+        }
+        if ((*C)->statistics)
+                releaseStatistics(&(*C)->statistics);
         StringBuffer_free(&(*C)->sb);
+        FREE((*C)->error);
 	FREE(*C);
 }
 
 
 void SQLiteConnection_setQueryTimeout(T C, int ms) {
 	assert(C);
-        C->timeout = ms;
-	sqlite3_busy_timeout(C->db, C->timeout);
+        C->busy.timeout = ms;
 }
 
 
@@ -199,6 +827,25 @@ int SQLiteConnection_ping(T C) {
 
 int SQLiteConnection_beginTransaction(T C) {
 	assert(C);
+        if (C->writer) {
+                if (C->inTransaction || C->locked) {
+                        FREE(C->error);
+                        C->lastError = SQLITE_ERROR;
+                        C->error = Str_dup(C->inTransaction ? "cannot start a transaction within a transaction" : "cannot start a transaction while a result set holds the single writer");
+                        return false;
+                }
+                if (! lockWriter(C))
+                        return false;
+                /* The writer is used by this connection only until commit or rollback and follows its query timeout */
+                C->writer->busy.timeout = C->busy.timeout;
+                if (! executeTransaction(C, "BEGIN IMMEDIATE TRANSACTION;")) {
+                        C->writer->busy.timeout = SQL_DEFAULT_TIMEOUT;
+                        Mutex_unlock(C->writer->lock);
+                        return false;
+                }
+                C->inTransaction = true;
+                return true;
+        }
         executeSQL(C, "BEGIN TRANSACTION;");
         return (C->lastError == SQLITE_OK);
 }
@@ -206,6 +853,8 @@ int SQLiteConnection_beginTransaction(T C) {
 
 int SQLiteConnection_commit(T C) {
 	assert(C);
+        if (C->writer)
+                return endTransaction(C, "commit");
         executeSQL(C, "COMMIT TRANSACTION;");
         return (C->lastError == SQLITE_OK);
 }
@@ -213,6 +862,8 @@ int SQLiteConnection_commit(T C) {
 
 int SQLiteConnection_rollback(T C) {
 	assert(C);
+        if (C->writer)
+                return endTransaction(C, "rollback");
         executeSQL(C, "ROLLBACK TRANSACTION;");
         return (C->lastError == SQLITE_OK);
 }
@@ -220,12 +871,16 @@ int SQLiteConnection_rollback(T C) {
 
 long long int SQLiteConnection_lastRowId(T C) {
         assert(C);
+        if (C->writer)
+                return C->rowid;
         return sqlite3_last_insert_rowid(C->db);
 }
 
 
 long long int SQLiteConnection_rowsChanged(T C) {
         assert(C);
+        if (C->writer)
+                return (long long int)C->changes;
         return (long long int)sqlite3_changes(C->db);
 }
 
@@ -237,7 +892,10 @@ int SQLiteConnection_execute(T C, const char *sql, va_list ap) {
         va_copy(ap_copy, ap);
         StringBuffer_vappend(C->sb, sql, ap_copy);
         va_end(ap_copy);
-	executeSQL(C, StringBuffer_toString(C->sb));
+        if (C->writer)
+                executeWrite(C, StringBuffer_toString(C->sb), NULL);
+        else
+                executeSQL(C, StringBuffer_toString(C->sb));
 	return (C->lastError == SQLITE_OK);
 }
 
@@ -247,19 +905,35 @@ ResultSet_T SQLiteConnection_executeQuery(T C, const char *sql, va_list ap) {
         const char *tail;
 	sqlite3_stmt *stmt;
 	assert(C);
+        /* In single-writer mode, a transaction reads from the writer to see its own changes */
+        sqlite3 *db = C->inTransaction ? C->writer->db : C->db;
         StringBuffer_clear(C->sb);
         va_copy(ap_copy, ap);
         StringBuffer_vappend(C->sb, sql, ap_copy);
         va_end(ap_copy);
+        if (C->writer)
+                FREE(C->error);
+        /* Statements on the connection's own database handle are cached. Statements on the writer are shared and not cached */
+        int cache = (db == C->db);
+        if (cache && (stmt = getCachedStatement(C, StringBuffer_toString(C->sb)))) {
+                collect(C, stmt);
+                C->lastError = SQLITE_OK;
+                return ResultSet_new(SQLiteResultSet_new(stmt, &C->busy, C->maxRows, true), (Rop_T)&sqlite3rops);
+        }
 #if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
-        C->lastError = sqlite3_blocking_prepare_v2(C->db, StringBuffer_toString(C->sb), StringBuffer_length(C->sb), &stmt, &tail);
+        C->lastError = sqlite3_blocking_prepare_v2(db, StringBuffer_toString(C->sb), StringBuffer_length(C->sb), &stmt, &tail);
+#elif SQLITE_VERSION_NUMBER >= 3020000
+        EXEC_SQLITE(C->lastError, sqlite3_prepare_v3(db, StringBuffer_toString(C->sb), StringBuffer_length(C->sb), cache ? SQLITE_PREPARE_PERSISTENT : 0, &stmt, &tail), &C->busy);
 #elif SQLITE_VERSION_NUMBER >= 3004000
-        EXEC_SQLITE(C->lastError, sqlite3_prepare_v2(C->db, StringBuffer_toString(C->sb), StringBuffer_length(C->sb), &stmt, &tail), C->timeout);
+        EXEC_SQLITE(C->lastError, sqlite3_prepare_v2(db, StringBuffer_toString(C->sb), StringBuffer_length(C->sb), &stmt, &tail), &C->busy);
 #else
-        EXEC_SQLITE(C->lastError, sqlite3_prepare(C->db, StringBuffer_toString(C->sb), StringBuffer_length(C->sb), &stmt, &tail), C->timeout);
+        EXEC_SQLITE(C->lastError, sqlite3_prepare(db, StringBuffer_toString(C->sb), StringBuffer_length(C->sb), &stmt, &tail), &C->busy);
 #endif
-	if (C->lastError == SQLITE_OK)
-		return ResultSet_new(SQLiteResultSet_new(stmt, C->maxRows, false), (Rop_T)&sqlite3rops);
+	if (C->lastError == SQLITE_OK) {
+                if (cache && stmt)
+                        cacheStatement(C, StringBuffer_toString(C->sb), stmt);
+		return ResultSet_new(SQLiteResultSet_new(stmt, &C->busy, C->maxRows, cache), (Rop_T)&sqlite3rops);
+        }
 	return NULL;
 }
 
@@ -276,22 +950,164 @@ PreparedStatement_T SQLiteConnection_prepareStatement(T C, const char *sql, va_l
 #if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
         C->lastError = sqlite3_blocking_prepare_v2(C->db, StringBuffer_toString(C->sb), -1, &stmt, &tail);
 #elif SQLITE_VERSION_NUMBER >= 3004000
-        EXEC_SQLITE(C->lastError, sqlite3_prepare_v2(C->db, StringBuffer_toString(C->sb), -1, &stmt, &tail), C->timeout);
+        EXEC_SQLITE(C->lastError, sqlite3_prepare_v2(C->db, StringBuffer_toString(C->sb), -1, &stmt, &tail), &C->busy);
 #else
-        EXEC_SQLITE(C->lastError, sqlite3_prepare(C->db, StringBuffer_toString(C->sb), -1, &stmt, &tail), C->timeout);
+        EXEC_SQLITE(C->lastError, sqlite3_prepare(C->db, StringBuffer_toString(C->sb), -1, &stmt, &tail), &C->busy);
 #endif
-        if (C->lastError == SQLITE_OK)
-		return PreparedStatement_new(SQLitePreparedStatement_new(C->db, stmt, C->maxRows), (Pop_T)&sqlite3pops);
+        if (C->writer)
+                FREE(C->error);
+        if (C->lastError == SQLITE_OK) {
+                /* In single-writer mode, statements which write are prepared on and executed by the writer.
+                 Inside a transaction queries are prepared on the writer too, to see the transaction's changes */
+                int readonly = sqlite3_stmt_readonly(stmt);
+                if (C->writer && (! readonly || C->inTransaction)) {
+                        sqlite3_finalize(stmt);
+                        C->lastError = sqlite3_prepare_v2(C->writer->db, StringBuffer_toString(C->sb), -1, &stmt, &tail);
+                        if (C->lastError == SQLITE_OK)
+                                return PreparedStatement_new(SQLitePreparedStatement_new(C->writer->db, stmt, &C->busy, C->maxRows, C, ! readonly), (Pop_T)&sqlite3pops);
+                        C->error = Str_dup(sqlite3_errmsg(C->writer->db));
+                        return NULL;
+                }
+		return PreparedStatement_new(SQLitePreparedStatement_new(C->db, stmt, &C->busy, C->maxRows, C, false), (Pop_T)&sqlite3pops);
+        }
 	return NULL;
 }
 
 
 const char *SQLiteConnection_getLastError(T C) {
 	assert(C);
+        if (C->error)
+                return C->error;
 	return sqlite3_errmsg(C->db);
 }
 
 
+Blob_T SQLiteConnection_openBlob(T C, const char *table, const char *column, long long int rowid, int write) {
+        sqlite3_blob *blob;
+        assert(C);
+        sqlite3 *db = C->db;
+        if (C->writer) {
+                FREE(C->error);
+                /* The writer is shared and an open Blob would hold a write transaction on it between batches */
+                if (write && ! C->inTransaction) {
+                        C->lastError = SQLITE_MISUSE;
+                        C->error = Str_dup("a Blob can only be opened for writing inside a transaction in single-writer mode");
+                        return NULL;
+                }
+                if (C->inTransaction)
+                        db = C->writer->db;
+        }
+#if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
+        C->lastError = sqlite3_blob_open(db, "main", table, column, rowid, write, &blob);
+#else
+        EXEC_SQLITE(C->lastError, sqlite3_blob_open(db, "main", table, column, rowid, write, &blob), &C->busy);
+#endif
+        if (C->lastError == SQLITE_OK)
+                return Blob_new(SQLiteBlob_new(db, blob), (Bop_T)&sqlite3bops);
+        if (db != C->db)
+                C->error = Str_dup(sqlite3_errmsg(db));
+        return NULL;
+}
+
+
+void SQLiteConnection_mapStatistics(T C, void apply(const char *sql, long long int executions, const long long int counters[], void *ap), void *ap) {
+        int n = 0;
+        SQLiteStatement_T copy = NULL;
+        assert(C);
+        if (! C->statistics)
+                return;
+        /* Apply on a copy so apply may use a Connection to the same database */
+        LOCK(C->statistics->mutex)
+        {
+                if (C->statistics->size) {
+                        copy = CALLOC(C->statistics->size, sizeof *copy);
+                        for (int i = 0; i < SQLITE_STATISTICS_BUCKETS; i++) {
+                                for (SQLiteStatement_T e = C->statistics->table[i]; e; e = e->next) {
+                                        copy[n] = *e;
+                                        copy[n++].sql = Str_dup(e->sql);
+                                }
+                        }
+                }
+        }
+        END_LOCK;
+        for (int i = 0; i < n; i++) {
+                apply(copy[i].sql, copy[i].executions, copy[i].counters, ap);
+                FREE(copy[i].sql);
+        }
+        FREE(copy);
+}
+
+
+/* Add the counters of a statement's last execution to the statistics and reset them */
+void SQLiteConnection_collect(T C, void *stmt) {
+        assert(C);
+        collect(C, stmt);
+}
+
+
+/* Step a statement prepared on the writer in single-writer mode */
+int SQLiteConnection_write(T C, void *stmt) {
+        assert(C);
+        assert(C->writer);
+        executeWrite(C, NULL, stmt);
+        return C->lastError;
+}
+
+
+/* Lock the writer for a result set which steps a statement on the writer's database outside
+ a transaction, such as INSERT .. RETURNING or a query prepared inside a transaction, so it
+ cannot run inside a batch. Returns true if the result set must call SQLiteConnection_unlockWriter()
+ when freed. Throws SQLException if the query timeout is reached */
+int SQLiteConnection_lockWriter(T C, void *db) {
+        assert(C);
+        if (! C->writer || db != C->writer->db || C->inTransaction)
+                return false;
+        if (! C->locked && ! lockWriter(C))
+                THROW(SQLException, "%s", C->error);
+        C->locked++;
+        return true;
+}
+
+
+void SQLiteConnection_unlockWriter(void *C) {
+        T c = C;
+        assert(c && c->locked > 0);
+        if (--c->locked == 0)
+                Mutex_unlock(c->writer->lock);
+}
+
+
+/* Event handler: Checkpoint the WAL from the pool's reaper thread. Passive while the pool
+ is in use, otherwise the WAL is checkpointed in full and truncated */
+void SQLiteConnection_onsweep(T C, int idle) {
+        assert(C);
+        if (C->writer) {
+                LOCK(C->writer->lock)
+                {
+                        checkpoint(C->writer->db, idle);
+                }
+                END_LOCK;
+        } else {
+                checkpoint(C->db, idle);
+        }
+}
+
+
+/* Event handler: The WAL is checkpointed by the pool's reaper thread. With the URL option
+ reaper-checkpoint=true, turn off automatic checkpoints, which otherwise run inline in
+ the commit which fills the WAL */
+void SQLiteConnection_onreaper(T C) {
+        assert(C);
+#if SQLITE_VERSION_NUMBER >= 3007006
+        if (getOption(C->url, "reaper-checkpoint", false)) {
+                sqlite3_wal_autocheckpoint(C->db, 0);
+                if (C->writer)
+                        sqlite3_wal_autocheckpoint(C->writer->db, 0);
+        }
+#endif
+}
+
+
 /* Class Method: SQLite3 client library finalization */
 void SQLiteConnection_onstop(void) {
 #if SQLITE_VERSION_NUMBER >= 3006000
@@ -38,7 +38,15 @@ int SQLiteConnection_execute(T C, const char *sql, va_list ap);
 ResultSet_T SQLiteConnection_executeQuery(T C, const char *sql, va_list ap);
 PreparedStatement_T SQLiteConnection_prepareStatement(T C, const char *sql, va_list ap);
 const char *SQLiteConnection_getLastError(T C);
+Blob_T SQLiteConnection_openBlob(T C, const char *table, const char *column, long long int rowid, int write);
+void SQLiteConnection_mapStatistics(T C, void apply(const char *sql, long long int executions, const long long int counters[], void *ap), void *ap);
+int SQLiteConnection_write(T C, void *stmt);
+int SQLiteConnection_lockWriter(T C, void *db);
+void SQLiteConnection_unlockWriter(void *C);
+void SQLiteConnection_collect(T C, void *stmt);
 /* Event handlers */
+void SQLiteConnection_onsweep(T C, int idle);
+void SQLiteConnection_onreaper(T C);
 void SQLiteConnection_onstop(void);
 #undef T
 #endif
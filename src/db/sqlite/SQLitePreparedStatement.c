@@ -26,13 +26,19 @@
 #include "Config.h"
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <sqlite3.h>
 
+#include "URL.h"
 #include "system/Time.h"
 #include "ResultSet.h"
+#include "PreparedStatement.h"
+#include "Blob.h"
 #include "SQLiteResultSet.h"
+#include "ConnectionDelegate.h"
 #include "PreparedStatementDelegate.h"
 #include "SQLitePreparedStatement.h"
+#include "SQLiteConnection.h"
 
 
 /**
@@ -54,7 +60,8 @@ const struct Pop_T sqlite3pops = {
         SQLitePreparedStatement_setDouble,
         SQLitePreparedStatement_setBlob,
         SQLitePreparedStatement_execute,
-        SQLitePreparedStatement_executeQuery
+        SQLitePreparedStatement_executeQuery,
+        SQLitePreparedStatement_getStatus
 };
 
 #define T PreparedStatementDelegate_T
@@ -63,6 +70,9 @@ struct T {
         int maxRows;
         int lastError;
 	sqlite3_stmt *stmt;
+        SQLiteBusy_T *busy;
+        int writer; // True if the statement is executed by the single writer
+        ConnectionDelegate_T delegate;
 };
 
 extern const struct Rop_T sqlite3rops;
@@ -75,12 +85,15 @@ extern const struct Rop_T sqlite3rops;
 #pragma GCC visibility push(hidden)
 #endif
 
-T SQLitePreparedStatement_new(sqlite3 *db, void *stmt, int maxRows) {
+T SQLitePreparedStatement_new(sqlite3 *db, void *stmt, SQLiteBusy_T *busy, int maxRows, ConnectionDelegate_T delegate, int writer) {
         T P;
         assert(stmt);
         NEW(P);
         P->db = db;
         P->stmt = stmt;
+        P->busy = busy;
+        P->delegate = delegate;
+        P->writer = writer;
         P->maxRows = maxRows;
         P->lastError = SQLITE_OK;
         return P;
@@ -89,6 +102,7 @@ T SQLitePreparedStatement_new(sqlite3 *db, void *stmt, int maxRows) {
 
 void SQLitePreparedStatement_free(T *P) {
 	assert(P && *P);
+        SQLiteConnection_collect((*P)->delegate, (*P)->stmt);
 	sqlite3_finalize((*P)->stmt);
 	FREE(*P);
 }
@@ -142,11 +156,16 @@ void SQLitePreparedStatement_setBlob(T P, int parameterIndex, const void *x, int
 
 void SQLitePreparedStatement_execute(T P) {
         assert(P);
+        SQLiteConnection_collect(P->delegate, P->stmt);
+        if (P->writer) {
+                P->lastError = SQLiteConnection_write(P->delegate, P->stmt);
+        } else {
 #if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
-        P->lastError = sqlite3_blocking_step(P->stmt);
+                P->lastError = sqlite3_blocking_step(P->stmt);
 #else
-        EXEC_SQLITE(P->lastError, sqlite3_step(P->stmt), SQL_DEFAULT_TIMEOUT);
+                EXEC_SQLITE(P->lastError, sqlite3_step(P->stmt), P->busy);
 #endif
+        }
         switch (P->lastError)
         {
                 case SQLITE_DONE: 
@@ -158,7 +177,7 @@ void SQLitePreparedStatement_execute(T P) {
                         break;
                 default:
                         P->lastError = sqlite3_reset(P->stmt);
-                        THROW(SQLException, "%s", sqlite3_errmsg(P->db));
+                        THROW(SQLException, "%s", P->writer ? SQLiteConnection_getLastError(P->delegate) : sqlite3_errmsg(P->db));
                         break;
         }
 }
@@ -166,12 +185,25 @@ void SQLitePreparedStatement_execute(T P) {
 
 ResultSet_T SQLitePreparedStatement_executeQuery(T P) {
         assert(P);
-        if (P->lastError == SQLITE_OK)
-                return ResultSet_new(SQLiteResultSet_new(P->stmt, P->maxRows, true), (Rop_T)&sqlite3rops);
+        SQLiteConnection_collect(P->delegate, P->stmt);
+        if (P->lastError == SQLITE_OK) {
+                // A statement on the single writer's database is stepped with the writer locked until the result set is freed
+                int locked = SQLiteConnection_lockWriter(P->delegate, P->db);
+                ResultSetDelegate_T R = SQLiteResultSet_new(P->stmt, P->busy, P->maxRows, true);
+                if (locked)
+                        SQLiteResultSet_onfree(R, SQLiteConnection_unlockWriter, P->delegate);
+                return ResultSet_new(R, (Rop_T)&sqlite3rops);
+        }
         THROW(SQLException, "%s", sqlite3_errmsg(P->db));
         return NULL;
 }
 
+
+long long int SQLitePreparedStatement_getStatus(T P, int counter) {
+        assert(P);
+        return sqlite_status(P->stmt, counter, false);
+}
+
 #ifdef PACKAGE_PROTECTED
 #pragma GCC visibility pop
 #endif
@@ -24,7 +24,7 @@
 #ifndef SQLITEPREPAREDSTATEMENT_INCLUDED
 #define SQLITEPREPAREDSTATEMENT_INCLUDED
 #define T PreparedStatementDelegate_T
-T SQLitePreparedStatement_new(sqlite3 *db, void *stmt, int maxRows);
+T SQLitePreparedStatement_new(sqlite3 *db, void *stmt, SQLiteBusy_T *busy, int maxRows, ConnectionDelegate_T delegate, int writer);
 void SQLitePreparedStatement_free(T *P);
 void SQLitePreparedStatement_setString(T P, int parameterIndex, const char *x);
 void SQLitePreparedStatement_setInt(T P, int parameterIndex, int x);
@@ -33,5 +33,6 @@ void SQLitePreparedStatement_setDouble(T P, int parameterIndex, double x);
 void SQLitePreparedStatement_setBlob(T P, int parameterIndex, const void *x, int size);
 void SQLitePreparedStatement_execute(T P);
 ResultSet_T SQLitePreparedStatement_executeQuery(T P);
+long long int SQLitePreparedStatement_getStatus(T P, int counter);
 #undef T
 #endif
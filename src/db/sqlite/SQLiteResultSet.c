@@ -27,9 +27,12 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
+#include <limits.h>
 #include <sqlite3.h>
 
 #include "system/Time.h"
+#include "ResultSet.h"
 #include "ResultSetDelegate.h"
 #include "SQLiteResultSet.h"
 
@@ -54,15 +57,26 @@ const struct Rop_T sqlite3rops = {
         SQLiteResultSet_getColumnSize,
         SQLiteResultSet_getString,
         SQLiteResultSet_getBlob,
+        SQLiteResultSet_getStatus,
+        SQLiteResultSet_isnull,
+        SQLiteResultSet_getInt,
+        SQLiteResultSet_getLLong,
+        SQLiteResultSet_getDouble,
+        SQLiteResultSet_fetchBatch,
+        SQLiteResultSet_getColumnType
 };
 
 #define T ResultSetDelegate_T
 struct T {
+        int stop;
         int keep;
         int maxRows;
 	int currentRow;
 	int columnCount;
 	sqlite3_stmt *stmt;
+        SQLiteBusy_T *busy;
+        void (*release)(void *ap);
+        void *ap;
 };
 
 #define TEST_INDEX \
@@ -70,6 +84,29 @@ struct T {
         i < 0 || i >= R->columnCount) THROW(SQLException, "Column index is out of range");
 
 
+/* ------------------------------------------------------- Private methods */
+
+
+/* Map a declared column type to a column type using SQLite's type affinity rules. Columns
+ with NUMERIC affinity, such as DATE or DECIMAL, or without a declared type may hold any value and are mapped to text */
+static int getAffinity(const char *decltype) {
+        char type[64];
+        int i;
+        for (i = 0; decltype[i] && i < (int)sizeof(type) - 1; i++)
+                type[i] = toupper(decltype[i]);
+        type[i] = 0;
+        if (strstr(type, "INT"))
+                return ColumnType_Integer;
+        if (strstr(type, "CHAR") || strstr(type, "CLOB") || strstr(type, "TEXT"))
+                return ColumnType_Text;
+        if (strstr(type, "BLOB"))
+                return ColumnType_Blob;
+        if (strstr(type, "REAL") || strstr(type, "FLOA") || strstr(type, "DOUB"))
+                return ColumnType_Real;
+        return ColumnType_Text;
+}
+
+
 /* ----------------------------------------------------- Protected methods */
 
 
@@ -77,11 +114,12 @@ struct T {
 #pragma GCC visibility push(hidden)
 #endif
 
-T SQLiteResultSet_new(void *stmt, int maxRows, int keep) {
+T SQLiteResultSet_new(void *stmt, SQLiteBusy_T *busy, int maxRows, int keep) {
 	T R;
 	assert(stmt);
 	NEW(R);
 	R->stmt = stmt;
+        R->busy = busy;
         R->keep = keep;
         R->maxRows = maxRows;
         R->columnCount = sqlite3_column_count(R->stmt);
@@ -95,10 +133,20 @@ void SQLiteResultSet_free(T *R) {
                 sqlite3_reset((*R)->stmt);
         else
                 sqlite3_finalize((*R)->stmt);
+        if ((*R)->release)
+                (*R)->release((*R)->ap);
 	FREE(*R);
 }
 
 
+/* Call release with ap when the result set is freed, after its statement is reset */
+void SQLiteResultSet_onfree(T R, void release(void *ap), void *ap) {
+        assert(R);
+        R->release = release;
+        R->ap = ap;
+}
+
+
 int SQLiteResultSet_getColumnCount(T R) {
 	assert(R);
 	return R->columnCount;
@@ -119,12 +167,12 @@ const char *SQLiteResultSet_getColumnName(T R, int column) {
 int SQLiteResultSet_next(T R) {
         int status;
 	assert(R);
-        if (R->maxRows && (R->currentRow++ >= R->maxRows))
+        if (R->stop || (R->maxRows && (R->currentRow++ >= R->maxRows)))
                 return false;
 #if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
 	status = sqlite3_blocking_step(R->stmt);
 #else
-        EXEC_SQLITE(status, sqlite3_step(R->stmt), SQL_DEFAULT_TIMEOUT);
+        EXEC_SQLITE(status, sqlite3_step(R->stmt), R->busy);
 #endif
         if (status != SQLITE_ROW && status != SQLITE_DONE) {
 #ifdef HAVE_SQLITE3_ERRSTR
@@ -133,6 +181,8 @@ int SQLiteResultSet_next(T R) {
                 THROW(SQLException, "sqlite3_step -- error code: %d", status);
 #endif
         }
+        // Stepping again after the last row would execute the statement again
+        R->stop = (status == SQLITE_DONE);
         return (status == SQLITE_ROW);
 }
 
@@ -157,6 +207,80 @@ const void *SQLiteResultSet_getBlob(T R, int columnIndex, int *size) {
         return blob;
 }
 
+
+long long int SQLiteResultSet_getStatus(T R, int counter) {
+        assert(R);
+        return sqlite_status(R->stmt, counter, false);
+}
+
+
+int SQLiteResultSet_isnull(T R, int columnIndex) {
+        TEST_INDEX
+        return (sqlite3_column_type(R->stmt, i) == SQLITE_NULL);
+}
+
+
+int SQLiteResultSet_getInt(T R, int columnIndex) {
+        long long int l = SQLiteResultSet_getLLong(R, columnIndex);
+        if (l < INT_MIN || l > INT_MAX)
+                THROW(SQLException, "NumberFormatException: For input string %lld -- Numerical result out of range", l);
+        return (int)l;
+}
+
+
+/* Numeric values are read as stored, only text and blob values are parsed */
+long long int SQLiteResultSet_getLLong(T R, int columnIndex) {
+        TEST_INDEX
+        switch (sqlite3_column_type(R->stmt, i)) {
+                case SQLITE_NULL: return 0;
+                case SQLITE_INTEGER:
+                case SQLITE_FLOAT: return sqlite3_column_int64(R->stmt, i);
+        }
+        return Str_parseLLong((const char*)sqlite3_column_text(R->stmt, i));
+}
+
+
+double SQLiteResultSet_getDouble(T R, int columnIndex) {
+        TEST_INDEX
+        switch (sqlite3_column_type(R->stmt, i)) {
+                case SQLITE_NULL: return 0.0;
+                case SQLITE_INTEGER:
+                case SQLITE_FLOAT: return sqlite3_column_double(R->stmt, i);
+        }
+        return Str_parseDouble((const char*)sqlite3_column_text(R->stmt, i));
+}
+
+
+int SQLiteResultSet_fetchBatch(T R, int maxRows, RowBuffer_T B) {
+        int rows = 0;
+        assert(R);
+        while (rows < maxRows && SQLiteResultSet_next(R)) {
+                for (int i = 0; i < R->columnCount; i++) {
+                        /* Get the value before its size as the size may change when converted */
+                        const void *value = sqlite3_column_text(R->stmt, i);
+                        RowBuffer_append(B, value, sqlite3_column_bytes(R->stmt, i));
+                }
+                rows++;
+        }
+        return rows;
+}
+
+
+/* The declared type of a table column, or the type of the value in the current row for
+ an expression */
+int SQLiteResultSet_getColumnType(T R, int columnIndex) {
+        TEST_INDEX
+        const char *decltype = sqlite3_column_decltype(R->stmt, i);
+        if (decltype)
+                return getAffinity(decltype);
+        switch (sqlite3_column_type(R->stmt, i)) {
+                case SQLITE_INTEGER: return ColumnType_Integer;
+                case SQLITE_FLOAT: return ColumnType_Real;
+                case SQLITE_BLOB: return ColumnType_Blob;
+        }
+        return ColumnType_Text;
+}
+
 #ifdef PACKAGE_PROTECTED
 #pragma GCC visibility pop
 #endif
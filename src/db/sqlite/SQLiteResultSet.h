@@ -98,27 +98,90 @@ static inline int sqlite3_blocking_exec(sqlite3 *db, const char *zSql, int (*cal
         }
         return rc;
 }
-#else
-/* SQLite timed retry macro */
-#define EXEC_SQLITE(status, action, timeout) \
+#endif
+
+
+/* Busy wait state of a connection. Used by the connection's busy handler and
+ when retrying statements which failed because a table was locked */
+typedef struct SQLiteBusy {
+        int timeout;            // Query timeout in milliseconds, 0 means no limit
+        unsigned int seed;      // Jitter seed for rand_r(), which unlike rand() does not lock
+        long long int started;  // Time in milliseconds when the current wait started
+        long long int waits;    // Number of busy waits performed
+        long long int waited;   // Total time spent in busy waits in microseconds
+} SQLiteBusy_T;
+
+#define SQLITE_BACKOFF_MIN_USEC 500
+#define SQLITE_BACKOFF_MAX_USEC 100000
+
+/* Sleep before the database is tried again. Count is the number of times this
+ was called for the same lock. Use exponential backoff with jitter, bounded by
+ the query timeout. Returns false if the timeout was reached and the caller
+ should give up */
+static inline int sqlite_backoff(SQLiteBusy_T *busy, int count) {
+        long long int now = Time_milli();
+        if (count == 0)
+                busy->started = now;
+        long long int remaining = (busy->timeout - (now - busy->started)) * USEC_PER_MSEC;
+        if (busy->timeout > 0 && remaining <= 0)
+                return false;
+        long delay = SQLITE_BACKOFF_MIN_USEC << (count < 8 ? count : 8);
+        if (delay > SQLITE_BACKOFF_MAX_USEC)
+                delay = SQLITE_BACKOFF_MAX_USEC;
+        delay = delay / 2 + rand_r(&busy->seed) % (delay / 2 + 1);
+        if (busy->timeout > 0 && delay > remaining)
+                delay = (long)remaining;
+        Time_usleep(delay);
+        busy->waits++;
+        busy->waited += delay;
+        return true;
+}
+
+
+#if ! (defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012)
+/* Retry action while the database table is locked. A busy database is handled
+ by the connection's busy handler, see SQLiteConnection.c */
+#define EXEC_SQLITE(status, action, busy) \
         do {\
-                long t = (timeout * USEC_PER_MSEC);\
-                int x = 0;\
-                do {\
-                        status = (action);\
-                } while (((status == SQLITE_BUSY) || (status == SQLITE_LOCKED)) && (x++ <= 9) && ((Time_usleep(t/(rand() % 10 + 100)))));\
+                int _count = 0;\
+                while ((((status = (action)) & 0xff) == SQLITE_LOCKED) && sqlite_backoff((busy), _count++)) ;\
         } while (0)
 #endif
 
 
+/* Return the SQLite statement counter for counter in SQLStatus_T or -1 if the
+ counter is not supported by this SQLite version. Reset the counter if reset is true */
+static inline long long int sqlite_status(sqlite3_stmt *stmt, int counter, int reset) {
+        switch (counter) {
+                case SQL_STATUS_FULLSCAN_STEP: return sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, reset);
+                case SQL_STATUS_SORT: return sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, reset);
+#ifdef SQLITE_STMTSTATUS_AUTOINDEX
+                case SQL_STATUS_AUTOINDEX: return sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, reset);
+#endif
+#ifdef SQLITE_STMTSTATUS_VM_STEP
+                case SQL_STATUS_VM_STEP: return sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, reset);
+#endif
+        }
+        return -1;
+}
+
+
 #define T ResultSetDelegate_T
-T SQLiteResultSet_new(void *stmt, int maxRows, int keep);
+T SQLiteResultSet_new(void *stmt, SQLiteBusy_T *busy, int maxRows, int keep);
 void SQLiteResultSet_free(T *R);
+void SQLiteResultSet_onfree(T R, void release(void *ap), void *ap);
 int SQLiteResultSet_getColumnCount(T R);
 const char *SQLiteResultSet_getColumnName(T R, int column);
 int SQLiteResultSet_next(T R);
 long SQLiteResultSet_getColumnSize(T R, int columnIndex);
 const char *SQLiteResultSet_getString(T R, int columnIndex);
 const void *SQLiteResultSet_getBlob(T R, int columnIndex, int *size);
+long long int SQLiteResultSet_getStatus(T R, int counter);
+int SQLiteResultSet_isnull(T R, int columnIndex);
+int SQLiteResultSet_getInt(T R, int columnIndex);
+long long int SQLiteResultSet_getLLong(T R, int columnIndex);
+double SQLiteResultSet_getDouble(T R, int columnIndex);
+int SQLiteResultSet_fetchBatch(T R, int maxRows, RowBuffer_T B);
+int SQLiteResultSet_getColumnType(T R, int columnIndex);
 #undef T
 #endif
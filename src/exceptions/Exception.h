@@ -233,11 +233,12 @@ void Exception_throw(const T *e, const char *func, const char *file, int line, c
 
 /**
  * Re-throws an exception. In a CATCH or ELSE block clients can use RETHROW
- * to re-throw the Exception
+ * to re-throw the Exception with its cause
  * @hideinitializer
  */
 #define RETHROW Exception_throw(Exception_frame.exception, \
-        Exception_frame.func, Exception_frame.file, Exception_frame.line, NULL)
+        Exception_frame.func, Exception_frame.file, Exception_frame.line, \
+        Exception_frame.message[0] ? "%s" : NULL, Exception_frame.message)
 
 
 /**
@@ -30,7 +30,12 @@
 #include <string.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <limits.h>
 #include <stdlib.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HAVE_SIMD_HEX 1
+#include <immintrin.h>
+#endif
 
 
 /**
@@ -40,6 +45,108 @@
  */
 
 
+/* ------------------------------------------------------- Private methods */
+
+
+/* Returns the value of the hex digit c or -1 if c is not a hex digit */
+static inline int hexValue(int c) {
+        if (c >= '0' && c <= '9')
+                return c - '0';
+        c |= 0x20;
+        if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+        return -1;
+}
+
+
+#ifdef HAVE_SIMD_HEX
+
+/* Vector hex decoding. Each character is mapped to its nibble and pairs of
+ nibbles are merged in 16 bit lanes and packed to bytes. A block is decoded
+ only if all its characters are hex digits, otherwise the caller continues
+ with the scalar path which handle whitespace between digit pairs. SSE2 is
+ part of x86-64, AVX2 is used if the CPU supports it */
+
+#define AVX2 __attribute__((target("avx2")))
+
+/* True if the CPU supports AVX2. Set once at load time, before any thread can decode */
+static int avx2 = 0;
+
+__attribute__((constructor)) static void initAVX2(void) {
+        __builtin_cpu_init();
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+}
+
+static inline int nibbles16(__m128i v, __m128i *n) {
+        __m128i digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        __m128i alpha = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        // Unsigned range test with signed compare: x < k <=> (x ^ 0x80) < (k ^ 0x80)
+        __m128i isDigit = _mm_cmplt_epi8(_mm_xor_si128(digit, _mm_set1_epi8((char)0x80)), _mm_set1_epi8((char)(10 ^ 0x80)));
+        __m128i isAlpha = _mm_cmplt_epi8(_mm_xor_si128(alpha, _mm_set1_epi8((char)0x80)), _mm_set1_epi8((char)(6 ^ 0x80)));
+        *n = _mm_or_si128(_mm_and_si128(isDigit, digit), _mm_and_si128(isAlpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+        return _mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha)) == 0xffff;
+}
+
+
+static inline __m128i merge16(__m128i n) {
+        return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n, _mm_set1_epi16(0xff)), 4), _mm_srli_epi16(n, 8));
+}
+
+
+static int decodeHex16(uchar_t *d, const uchar_t *s, int len) {
+        int n = 0;
+        for (__m128i a, b; n + 32 <= len; n += 32) {
+                if (! (nibbles16(_mm_loadu_si128((const __m128i *)(s + n)), &a) && nibbles16(_mm_loadu_si128((const __m128i *)(s + n + 16)), &b)))
+                        break;
+                _mm_storeu_si128((__m128i *)(d + n / 2), _mm_packus_epi16(merge16(a), merge16(b)));
+        }
+        return n;
+}
+
+
+AVX2 static inline int nibbles32(__m256i v, __m256i *n) {
+        __m256i digit = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+        __m256i alpha = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i isDigit = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(10 ^ 0x80)), _mm256_xor_si256(digit, _mm256_set1_epi8((char)0x80)));
+        __m256i isAlpha = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(6 ^ 0x80)), _mm256_xor_si256(alpha, _mm256_set1_epi8((char)0x80)));
+        *n = _mm256_or_si256(_mm256_and_si256(isDigit, digit), _mm256_and_si256(isAlpha, _mm256_add_epi8(alpha, _mm256_set1_epi8(10))));
+        return _mm256_movemask_epi8(_mm256_or_si256(isDigit, isAlpha)) == -1;
+}
+
+
+AVX2 static inline __m256i merge32(__m256i n) {
+        return _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(n, _mm256_set1_epi16(0xff)), 4), _mm256_srli_epi16(n, 8));
+}
+
+
+AVX2 static int decodeHex32(uchar_t *d, const uchar_t *s, int len) {
+        int n = 0;
+        for (__m256i a, b; n + 64 <= len; n += 64) {
+                if (! (nibbles32(_mm256_loadu_si256((const __m256i *)(s + n)), &a) && nibbles32(_mm256_loadu_si256((const __m256i *)(s + n + 32)), &b)))
+                        break;
+                // Packing works per 128 bit lane, restore the order of the four 64 bit results
+                _mm256_storeu_si256((__m256i *)(d + n / 2), _mm256_permute4x64_epi64(_mm256_packus_epi16(merge32(a), merge32(b)), 0xD8));
+        }
+        return n + decodeHex16(d + n / 2, s + n, len - n);
+}
+
+
+/* Decode a run of hex digits, returns the number of characters decoded */
+static inline int decodeBlock(uchar_t *d, const uchar_t *s, int len) {
+        if (len < 32)
+                return 0;
+        return avx2 ? decodeHex32(d, s, len) : decodeHex16(d, s, len);
+}
+
+#else
+
+static inline int decodeBlock(uchar_t *d, const uchar_t *s, int len) {
+        return 0;
+}
+
+#endif
+
+
 /* ----------------------------------------------------- Protected methods */
 
 
@@ -155,10 +262,12 @@ int Str_parseInt(const char *s) {
 		THROW(SQLException, "NumberFormatException: For input string null");
         errno = 0;
         char *e;
-	int i = (int)strtol(s, &e, 10);
+	long l = strtol(s, &e, 10);
+        if (! errno && (l < INT_MIN || l > INT_MAX))
+                errno = ERANGE;
 	if (errno || (e == s))
 		THROW(SQLException, "NumberFormatException: For input string %s -- %s", s, System_getLastError());
-	return i;
+	return (int)l;
 }
 
 
@@ -185,6 +294,31 @@ double Str_parseDouble(const char *s) {
 	return d;
 }
 
+
+int Str_decodeHex(void *dest, const char *src, int len) {
+        uchar_t *d = dest;
+        const uchar_t *s = (const uchar_t *)src;
+        int i = 0, j = 0;
+        assert(dest);
+        assert(src);
+        while (j < len) {
+                int n = decodeBlock(d + i, s + j, len - j);
+                i += n / 2;
+                j += n;
+                if (j >= len)
+                        break;
+                int hi = hexValue(s[j]);
+                if (hi < 0) {
+                        j++;
+                        continue;
+                }
+                int lo = (j + 1 < len) ? hexValue(s[j + 1]) : 0;
+                d[i++] = (uchar_t)((hi << 4) | (lo < 0 ? 0 : lo));
+                j += 2;
+        }
+        return i;
+}
+
 #ifdef PACKAGE_PROTECTED
 #pragma GCC visibility pop
 #endif
@@ -167,4 +167,19 @@ long long int Str_parseLLong(const char *s);
 double Str_parseDouble(const char *s);
 
 
+/**
+ * Decodes the hex digit pairs in the first <code>len</code> characters of
+ * <code>src</code> into bytes in <code>dest</code>. Characters between
+ * digit pairs which are not hex digits, such as whitespace, are skipped.
+ * <code>dest</code> may overlap <code>src</code> if it does not start after
+ * it, so a string can be decoded in place.
+ * Long runs of digits are decoded with SSE2 or AVX2 on x86-64.
+ * @param dest A buffer of at least len / 2 bytes
+ * @param src A string of hex digits
+ * @param len Number of characters in src to decode
+ * @return The number of bytes written to dest
+ */
+int Str_decodeHex(void *dest, const char *src, int len);
+
+
 #endif
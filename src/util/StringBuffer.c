@@ -42,10 +42,14 @@
 /* ----------------------------------------------------------- Definitions */
 
 
+/* Postgres uses a 16 bit parameter count in the protocol */
+#define MAX_PARAMETERS 65535
+
 #define T StringBuffer_T
 struct T {
         int used;
         int length;
+        int escapes;
 	uchar_t *buffer;
 };
 
@@ -69,35 +73,201 @@ static inline void append(T S, const char *s, va_list ap) {
 }
 
 
-/* Replace all occurences of ? in this string buffer with prefix[1..99] */
+static inline int isName(uchar_t c) {
+        return isalnum(c) || c == '_';
+}
+
+
+/* Return the index just past the quoted string or identifier starting at index
+ i. If escape is true a backslash escapes the next character */
+static inline int quote(const uchar_t *s, int i, int escape) {
+        int j;
+        for (j = i + 1; s[j] && s[j] != s[i]; j++)
+                if (escape && s[j] == '\\' && s[j + 1])
+                        j++;
+        return s[j] ? j + 1 : j;
+}
+
+
+/* Return the index just past the string literal, quoted identifier, comment or
+ Postgres dollar quoted string starting at index i, or i if none starts there.
+ Standard SQL has no backslash escapes, a backslash escapes the next character
+ only in a Postgres E'..' string or, if escapes is true, a MySQL string */
+static int skip(const uchar_t *s, int i, int escapes) {
+        int j;
+        switch (s[i]) {
+                case 'E':
+                case 'e':
+                        if (s[i + 1] != '\'' || (i && isName(s[i - 1])))
+                                return i;
+                        return quote(s, i + 1, true);
+                case '\'':
+                case '"':
+                        return quote(s, i, escapes);
+                case '`':
+                        return quote(s, i, false);
+                case '-':
+                        if (s[i + 1] != '-')
+                                return i;
+                        for (j = i + 2; s[j] && s[j] != '\n'; j++) ;
+                        return j;
+                case '/':
+                        if (s[i + 1] != '*')
+                                return i;
+                        for (j = i + 2; s[j] && ! (s[j] == '*' && s[j + 1] == '/'); j++) ;
+                        return s[j] ? j + 2 : j;
+                case '$':
+                        // $$ or $tag$, but not $n or a $ in an identifier
+                        if (i && isName(s[i - 1]))
+                                return i;
+                        for (j = i + 1; isName(s[j]) && ! (j == i + 1 && isdigit(s[j])); j++) ;
+                        if (s[j] != '$')
+                                return i;
+                        int tag = j - i + 1;
+                        for (j++; s[j]; j++)
+                                if (s[j] == '$' && strncmp((const char *)s + i, (const char *)s + j, tag) == 0)
+                                        return j + tag;
+                        return j;
+        }
+        return i;
+}
+
+
+/* Write the decimal parameter index n to s and return the number of digits */
+static inline int formatIndex(uchar_t *s, int n) {
+        uchar_t digits[10];
+        int i = 0, j = 0;
+        do digits[i++] = '0' + n % 10; while ((n /= 10));
+        while (i)
+                s[j++] = digits[--i];
+        return j;
+}
+
+
+/* Replace all ? parameters in this string buffer with prefix[1..65535] in one pass
+ into a new buffer. A ? in a literal, quoted identifier or comment is copied as is */
 static int prepare(T S, char prefix) {
-        int n, i;
-        for (n = i = 0; S->buffer[i]; i++) if (S->buffer[i] == '?') n++;
-        if (n > 99)
-                THROW(SQLException, "Max 99 parameters are allowed in a prepared statement. Found %d parameters in statement", n);
-        else if (n) {
-                int j, xl;
-                char x[3] = {prefix};
-                int required = (n * 2) + S->used;
-                if (required >= S->length) {
-                        S->length = required;
-                        RESIZE(S->buffer, S->length);
+        int n = 0, w = 0, length = S->used + STRLEN;
+        uchar_t *buffer = ALLOC(length);
+        for (int r = 0, e; r < S->used; r = e) {
+                int literal = (e = skip(S->buffer, r, S->escapes)) > r;
+                if (! literal)
+                        e = r + 1;
+                // Room for the copied span or a prefix with 5 digits and a terminating NUL
+                if (w + (e - r) + 7 > length) {
+                        length = 2 * length + (e - r);
+                        RESIZE(buffer, length);
                 }
-                for (i = 0, j = 1; (j <= n); i++) {
-                        if (S->buffer[i] == '?') {
-                                if(j<10){xl=2;x[1]=j+'0';}else{xl=3;x[1]=(j/10)+'0';x[2]=(j%10)+'0';}
-                                memmove(S->buffer + i + xl, S->buffer + i + 1, (S->used - (i + 1)));
-                                memmove(S->buffer + i, x, xl);
-                                S->used += xl - 1;
-                                j++;
+                if (! literal && S->buffer[r] == '?') {
+                        // Stop before an index would need more than the 5 digits reserved
+                        if (++n > MAX_PARAMETERS) {
+                                FREE(buffer);
+                                THROW(SQLException, "Max %d parameters are allowed in a prepared statement. Found more parameters in statement", MAX_PARAMETERS);
                         }
+                        buffer[w++] = prefix;
+                        w += formatIndex(buffer + w, n);
+                } else {
+                        memcpy(buffer + w, S->buffer + r, e - r);
+                        w += e - r;
                 }
-                S->buffer[S->used] = 0;
+        }
+        if (n) {
+                buffer[w] = 0;
+                FREE(S->buffer);
+                S->buffer = buffer;
+                S->length = length;
+                S->used = w;
+        } else {
+                FREE(buffer);
         }
         return n;
 }
 
 
+/* Return true if the keyword w, in upper case, ends at index i, ignoring white
+ space before i, and set start to the index of the keyword */
+static int isKeyword(const uchar_t *s, int i, const char *w, int *start) {
+        int n = (int)strlen(w);
+        while (i > 0 && isspace(s[i - 1]))
+                i--;
+        if (i < n || (i > n && isName(s[i - n - 1])))
+                return false;
+        for (int j = 0; j < n; j++)
+                if (toupper(s[i - n + j]) != w[j])
+                        return false;
+        *start = i - n;
+        return true;
+}
+
+
+/* Return true if the ? at index i is a list parameter, IN (?), and set start to
+ the index of IN, or of NOT if the list is negated */
+static int isList(const uchar_t *s, int i, int *start, int *negated) {
+        int j = i + 1, k = i;
+        while (isspace(s[j]))
+                j++;
+        while (k > 0 && isspace(s[k - 1]))
+                k--;
+        if (s[j] != ')' || k == 0 || s[k - 1] != '(' || ! isKeyword(s, k - 1, "IN", start))
+                return false;
+        *negated = isKeyword(s, *start, "NOT", start);
+        return true;
+}
+
+
+/* Find the list parameters in this string buffer in one pass into a new buffer.
+ A list parameter is expanded to sizes[n] parameters if sizes is given, or 
+ rewritten to a Postgres array parameter if any is true */
+static int rewriteLists(T S, const int *sizes, int any, void apply(int parameterIndex, void *ap), void *ap) {
+        int n = 0, lists = 0, w = 0, length = S->used + STRLEN;
+        uchar_t *buffer = ALLOC(length);
+        for (int r = 0, e; r < S->used; r = e) {
+                int start = 0, negated = false, size = 0;
+                int literal = (e = skip(S->buffer, r, S->escapes)) > r;
+                if (! literal) {
+                        e = r + 1;
+                        if (S->buffer[r] == '?') {
+                                n++;
+                                if (isList(S->buffer, r, &start, &negated)) {
+                                        if (apply)
+                                                apply(n, ap);
+                                        size = sizes ? sizes[lists] : 1;
+                                        lists++;
+                                }
+                        }
+                }
+                if (w + (e - r) + 3 * size + 8 > length) {
+                        length = 2 * length + (e - r) + 3 * size;
+                        RESIZE(buffer, length);
+                }
+                if (size && any) {
+                        // IN ( and NOT IN ( were copied as is, back up and write the array comparison instead
+                        w -= r - start;
+                        const char *array = negated ? "<> ALL(?" : "= ANY(?";
+                        memcpy(buffer + w, array, strlen(array));
+                        w += strlen(array);
+                } else if (size) {
+                        buffer[w++] = '?';
+                        for (int i = 1; i < size; i++, w += 3)
+                                memcpy(buffer + w, ", ?", 3);
+                } else {
+                        memcpy(buffer + w, S->buffer + r, e - r);
+                        w += e - r;
+                }
+        }
+        if (lists && (sizes || any)) {
+                buffer[w] = 0;
+                FREE(S->buffer);
+                S->buffer = buffer;
+                S->length = length;
+                S->used = w;
+        } else {
+                FREE(buffer);
+        }
+        return lists;
+}
+
+
 static inline T ctor(int hint) {
         T S;
         NEW(S);
@@ -164,6 +334,13 @@ int StringBuffer_length(T S) {
 }
 
 
+T StringBuffer_setEscapes(T S, int escapes) {
+        assert(S);
+        S->escapes = escapes;
+        return S;
+}
+
+
 T StringBuffer_clear(T S) {
         assert(S);
         S->used = 0;
@@ -190,6 +367,88 @@ int StringBuffer_prepare4oracle(T S) {
 }
 
 
+int StringBuffer_prepareNamed(T S, void apply(int parameterIndex, const char *name, int length, void *ap), void *ap) {
+        assert(S);
+        assert(apply);
+        int n = 0, w = 0, marks = 0;
+        uchar_t previous = 0;
+        for (int r = 0, e; r < S->used; r = e) {
+                uchar_t *p = S->buffer + r;
+                if ((e = skip(S->buffer, r, S->escapes)) > r) {
+                        previous = S->buffer[e - 1];
+                        memmove(S->buffer + w, p, e - r);
+                        w += e - r;
+                } else if (*p == ':' && isName(p[1]) && ! isdigit(p[1]) && ! isName(previous) && previous != ':') {
+                        // The name is read before the ? is written since w <= r
+                        for (e = r + 1; isName(S->buffer[e]); e++) ;
+                        n++;
+                        if (marks)
+                                break;
+                        apply(n, (const char *)p + 1, e - r - 1, ap);
+                        S->buffer[w++] = '?';
+                        previous = S->buffer[e - 1];
+                } else {
+                        marks += (*p == '?');
+                        if (marks && n)
+                                break;
+                        previous = *p;
+                        S->buffer[w++] = *p;
+                        e = r + 1;
+                }
+        }
+        // The names are positions among all parameters, which a ? would move
+        if (marks && n)
+                THROW(SQLException, "Named and ? parameters cannot be mixed in a prepared statement");
+        S->used = w;
+        S->buffer[w] = 0;
+        return n;
+}
+
+
+int StringBuffer_mapNamed(T S, void apply(const char *name, int length, void *ap), void *ap) {
+        assert(S);
+        assert(apply);
+        int n = 0;
+        uchar_t previous = 0;
+        for (int r = 0, e; r < S->used; r = e) {
+                const uchar_t *p = S->buffer + r;
+                if ((e = skip(S->buffer, r, S->escapes)) > r) {
+                        previous = S->buffer[e - 1];
+                        continue;
+                }
+                e = r + 1;
+                if (*p == '?') {
+                        apply(NULL, 0, ap);
+                } else if (*p == ':' && isName(p[1]) && ! isdigit(p[1]) && ! isName(previous) && previous != ':') {
+                        for (; isName(S->buffer[e]); e++) ;
+                        apply((const char *)p + 1, e - r - 1, ap);
+                        n++;
+                }
+                previous = S->buffer[e - 1];
+        }
+        return n;
+}
+
+
+int StringBuffer_mapLists(T S, void apply(int parameterIndex, void *ap), void *ap) {
+        assert(S);
+        return rewriteLists(S, NULL, false, apply, ap);
+}
+
+
+int StringBuffer_expandLists(T S, const int *sizes) {
+        assert(S);
+        assert(sizes);
+        return rewriteLists(S, sizes, false, NULL, NULL);
+}
+
+
+int StringBuffer_prepareAny(T S) {
+        assert(S);
+        return rewriteLists(S, NULL, true, NULL, NULL);
+}
+
+
 T StringBuffer_trim(T S) {
         assert(S);
         // Right trim and remove trailing semicolon
@@ -114,8 +114,22 @@ T StringBuffer_clear(T S);
 const char *StringBuffer_toString(T S);
 
 
+/**
+ * Set if a backslash escapes the next character in quoted strings when
+ * parameters are found in this string buffer, as in MySQL. By default only
+ * a backslash in a Postgres <code>E'..'</code> string is an escape, so
+ * <code>'C:\'</code> is a complete string literal.
+ * @param S StringBuffer object
+ * @param escapes true if backslash escapes are used, otherwise false
+ * @return a reference to this StringBuffer
+ */
+T StringBuffer_setEscapes(T S, int escapes);
+
+
 /**
  * Replace all occurences of <code>?</code> in this string buffer with <code>$n</code>.
+ * The buffer is rewritten in one pass and a <code>?</code> in a quoted string
+ * or identifier, a comment or a dollar quoted string is not a parameter.
  * Example: 
  * <pre>
  * StringBuffer_T b = StringBuffer_new("insert into host values(?, ?, ?);"); 
@@ -123,13 +137,14 @@ const char *StringBuffer_toString(T S);
  * </pre>
  * @param S StringBuffer object
  * @return The number of replacements that took place
- * @exception SQLException if there are more than 99 wild card '?' parameters
+ * @exception SQLException if there are more than 65535 wild card '?' parameters
  */
 int StringBuffer_prepare4postgres(T S);
 
 
 /**
  * Replace all occurences of <code>?</code> in this string buffer with <code>:n</code>.
+ * Parameters are found as with StringBuffer_prepare4postgres().
  * Example: 
  * <pre>
  * StringBuffer_T b = StringBuffer_new("insert into host values(?, ?, ?);"); 
@@ -137,11 +152,91 @@ int StringBuffer_prepare4postgres(T S);
  * </pre>
  * @param S StringBuffer object
  * @return The number of replacements that took place
- * @exception SQLException if there are more than 99 wild card '?' parameters
+ * @exception SQLException if there are more than 65535 wild card '?' parameters
  */
 int StringBuffer_prepare4oracle(T S);
 
 
+/**
+ * Replace all named parameters of the form <code>:name</code> in this string
+ * buffer with <code>?</code> in one pass. A name starts with a letter or 
+ * underscore, so Oracle style <code>:1</code> parameters are kept, as are
+ * Postgres <code>::type</code> casts and colons directly after a name, such as
+ * in an array slice. Quoted strings and identifiers, comments and dollar
+ * quoted strings are copied as is. The function <code>apply</code> is called
+ * with the position and name of each parameter replaced, in order. The name
+ * is not NUL terminated and is only valid during the call. Named and 
+ * <code>?</code> parameters cannot be mixed, as the position of a name 
+ * would not count the <code>?</code> parameters before it. Example: 
+ * <pre>
+ * StringBuffer_T b = StringBuffer_new("update host set name=:name where id=:id;"); 
+ * StringBuffer_prepareNamed(b, apply, ap) -> "update host set name=? where id=?;"
+ * </pre>
+ * @param S StringBuffer object
+ * @param apply The function called with each parameter name
+ * @param ap An application-specific pointer passed to apply
+ * @return The number of replacements that took place
+ * @exception SQLException if the statement also has <code>?</code> parameters
+ */
+int StringBuffer_prepareNamed(T S, void apply(int parameterIndex, const char *name, int length, void *ap), void *ap);
+
+
+/**
+ * Find the <code>?</code> and named <code>:name</code> parameters in this 
+ * string buffer, as StringBuffer_prepareNamed() but without changing the
+ * buffer. The function <code>apply</code> is called for each parameter in
+ * order, with the name of a named parameter or with NULL for a 
+ * <code>?</code>. Used for databases which bind named parameters natively.
+ * @param S StringBuffer object
+ * @param apply The function called for each parameter
+ * @param ap An application-specific pointer passed to apply
+ * @return The number of named parameters found
+ */
+int StringBuffer_mapNamed(T S, void apply(const char *name, int length, void *ap), void *ap);
+
+
+/**
+ * Find list parameters in this string buffer. A list parameter is a 
+ * <code>?</code> which is the only item of an IN list, as in 
+ * <code>id IN (?)</code> or <code>id NOT IN (?)</code>. The function 
+ * <code>apply</code> is called with the position of each list parameter among
+ * all <code>?</code> parameters, in order. The buffer is not changed. 
+ * @param S StringBuffer object
+ * @param apply The function called for each list parameter, may be NULL if
+ * only the number of list parameters is needed
+ * @param ap An application-specific pointer passed to apply
+ * @return The number of list parameters found
+ */
+int StringBuffer_mapLists(T S, void apply(int parameterIndex, void *ap), void *ap);
+
+
+/**
+ * Expand the list parameters in this string buffer, see StringBuffer_mapLists(),
+ * to a number of <code>?</code> parameters. Example: 
+ * <pre>
+ * StringBuffer_T b = StringBuffer_new("select a from b where c in (?) and d=? and e in (?);"); 
+ * StringBuffer_expandLists(b, (int[]){4, 2}) -> "select a from b where c in (?, ?, ?, ?) and d=? and e in (?, ?);"
+ * </pre>
+ * @param S StringBuffer object
+ * @param sizes The number of parameters for each list parameter, in order
+ * @return The number of list parameters expanded
+ */
+int StringBuffer_expandLists(T S, const int *sizes);
+
+
+/**
+ * Rewrite the list parameters in this string buffer, see StringBuffer_mapLists(),
+ * to compare with a Postgres array parameter. Example: 
+ * <pre>
+ * StringBuffer_T b = StringBuffer_new("select a from b where c in (?) and d not in (?);"); 
+ * StringBuffer_prepareAny(b) -> "select a from b where c = ANY(?) and d <> ALL(?);"
+ * </pre>
+ * @param S StringBuffer object
+ * @return The number of list parameters rewritten
+ */
+int StringBuffer_prepareAny(T S);
+
+
 /**
  * Remove (any) leading and trailing white space and semicolon [ \\t\\r\\n;]. Example
  * <pre>
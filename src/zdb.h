@@ -48,6 +48,8 @@ extern "C" {
 #include <URL.h>
 #include <ResultSet.h>
 #include <PreparedStatement.h>
+#include <Blob.h>
+#include <Arrow.h>
 #include <Connection.h>
 #include <ConnectionPool.h>
 #include <SQLException.h>
@@ -300,6 +300,7 @@ int main(void) {
                                 RETHROW;
                         END_TRY;
                 CATCH(A)
+                        assert(strcmp(Exception_frame.message, "A") == 0);
                         printf("\tResult: ok got Exception\n");
                 END_TRY;
         }
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "Config.h"
+#include "system/Time.h"
+
+
+/**
+ * Hex decoding micro benchmark. Compares Str_decodeHex() with the byte at a
+ * time loop previously used to decode Postgres bytea values in hex format.
+ * Run: ./hex [megabytes]
+ */
+
+#define ROUNDS 20
+
+
+static int decodeBytewise(uchar_t *d, const uchar_t *s, int len) {
+        static const uchar_t hex[128] = {
+                0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0,  1,  2,  3,  4,  5,  6, 7, 8, 9, 0, 0, 0, 0, 0, 0,
+                0, 10, 11, 12, 13, 14, 15, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0, 10, 11, 12, 13, 14, 15, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+        };
+        int i, j;
+        for (i = 0, j = 0; j < len; j++) {
+                if (isxdigit(s[j])) {
+                        d[i] = hex[s[j]] << 4;
+                        d[i] |= hex[s[j + 1]];
+                        i++;
+                        j++;
+                }
+        }
+        return i;
+}
+
+
+static int decodeStr(uchar_t *d, const uchar_t *s, int len) {
+        return Str_decodeHex(d, (const char *)s, len);
+}
+
+
+static double run(const char *name, int (*decode)(uchar_t *, const uchar_t *, int), uchar_t *d, const uchar_t *s, int len) {
+        int n = 0;
+        long long start = Time_milli();
+        for (int i = 0; i < ROUNDS; i++)
+                n += decode(d, s, len);
+        long long ms = Time_milli() - start;
+        double mbs = ms ? ((double)len * ROUNDS / (1024 * 1024)) / (ms / 1000.0) : 0;
+        printf("\tResult: %-13s %6lld ms %10.1f MB/s\n", name, ms, mbs);
+        assert(n / ROUNDS == len / 2);
+        return mbs;
+}
+
+
+int main(int argc, char **argv) {
+        int megabytes = argc > 1 ? atoi(argv[1]) : 8;
+        int len = megabytes * 1024 * 1024 * 2;
+        uchar_t *s = malloc(len + 1);
+        uchar_t *d = malloc(len / 2 + 1);
+        uchar_t *e = malloc(len / 2 + 1);
+        const char *digits = "0123456789abcdefABCDEF";
+        assert(s && d && e);
+        srand(1);
+        for (int i = 0; i < len; i++)
+                s[i] = digits[rand() % 22];
+        s[len] = 0;
+
+        printf("============> Start Hex Tests\n\n");
+
+        printf("=> Test1: Str_decodeHex equals bytewise decoding\n");
+        {
+                assert(decodeBytewise(d, s, len) == len / 2);
+                assert(decodeStr(e, s, len) == len / 2);
+                assert(memcmp(d, e, len / 2) == 0);
+        }
+        printf("=> Test1: OK\n\n");
+
+        printf("=> Test2: Decode %d MB hex encoded, %d rounds\n", megabytes, ROUNDS);
+        {
+                double bytewise = run("bytewise", decodeBytewise, d, s, len);
+                double vector = run("Str_decodeHex", decodeStr, d, s, len);
+                if (bytewise > 0)
+                        printf("\tResult: speedup %.1fx\n", vector / bytewise);
+        }
+        printf("=> Test2: OK\n\n");
+
+        printf("============> Hex Tests: OK\n\n");
+        free(s);
+        free(d);
+        free(e);
+        return 0;
+}
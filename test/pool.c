@@ -11,6 +11,8 @@
 #include "Vector.h"
 #include "ResultSet.h"
 #include "PreparedStatement.h"
+#include "Blob.h"
+#include "Arrow.h"
 #include "Connection.h"
 #include "ConnectionPool.h"
 #include "AssertException.h"
@@ -34,6 +36,22 @@ static void TabortHandler(const char *error) {
         exit(1);
 }
 
+typedef struct {
+        const char *data;
+        long size;
+        long offset;
+} Stream_T;
+
+static long readStream(void *buffer, long length, void *ap) {
+        Stream_T *stream = ap;
+        long n = stream->size - stream->offset;
+        if (n > length)
+                n = length > 1000 ? 1000 : length; // Read in small chunks
+        memcpy(buffer, stream->data + stream->offset, n);
+        stream->offset += n;
+        return n;
+}
+
 static void testPool(const char *testURL) {
         URL_T url;
         char *schema;
@@ -224,6 +242,108 @@ static void testPool(const char *testURL) {
                         //assert(strlen(image) + 1 == 8192);
                         //assert(imagesize == 8192);
                 }
+                printf("\tResult: check numeric and null values..");
+                rset = Connection_executeQuery(con, "select id, image from zild_t where id=1;");
+                assert(ResultSet_next(rset));
+                assert(! ResultSet_isnull(rset, 1));
+                assert(1 == ResultSet_getInt(rset, 1));
+                assert(1 == ResultSet_getLLong(rset, 1));
+                assert(1.0 == ResultSet_getDouble(rset, 1));
+                assert(Str_isEqual("1", ResultSet_getString(rset, 1)));
+                assert(ResultSet_isnull(rset, 2));
+                assert(0 == ResultSet_getLLong(rset, 2));
+                rset = Connection_executeQuery(con, "select id + 4294967296 from zild_t where id=1;");
+                assert(ResultSet_next(rset));
+                assert(4294967297LL == ResultSet_getLLong(rset, 1));
+                TRY
+                {
+                        ResultSet_getInt(rset, 1);
+                        printf("\tResult: getInt of a value out of int range succeeded\n");
+                        exit(1);
+                }
+                CATCH(SQLException)
+                {
+                        // OK
+                }
+                END_TRY;
+                printf("success\n");
+                printf("\tResult: check fetch batch..");
+                {
+                        RowBatch_T batch;
+                        int rows = 0;
+                        rset = Connection_executeQuery(con, "select id, name from zild_t order by id;");
+                        while ((i = ResultSet_fetchBatch(rset, 5, &batch))) {
+                                assert(i <= 5 && batch.columns == 2);
+                                for (int j = 0; j < batch.rows; j++, rows++) {
+                                        assert(Str_parseInt(batch.data + batch.offsets[j * 2]) == rows + 1);
+                                        if (rows == 1)
+                                                assert(Str_isEqual("Leela", batch.data + batch.offsets[j * 2 + 1]));
+                                }
+                        }
+                        assert(rows == 12);
+                }
+                printf("success\n");
+                printf("\tResult: check Arrow export..");
+                {
+                        struct ArrowSchema schema;
+                        struct ArrowArray array;
+                        rset = Connection_executeQuery(con, "select id, name from zild_t order by id;");
+                        assert(Arrow_exportResultSet(rset, 100, &schema, &array) == 12);
+                        assert(Str_isEqual(schema.format, "+s") && schema.n_children == 2);
+                        assert(array.length == 12 && array.n_children == 2);
+                        assert(Str_isEqual(schema.children[1]->name, "name"));
+                        if (Str_isEqual(schema.children[0]->format, "l"))
+                                assert(((const int64_t*)array.children[0]->buffers[1])[1] == 2);
+                        const int32_t *offsets = array.children[1]->buffers[1];
+                        assert(offsets[2] - offsets[1] == 5 && memcmp("Leela", (const char*)array.children[1]->buffers[2] + offsets[1], 5) == 0);
+                        schema.release(&schema);
+                        array.release(&array);
+                        assert(schema.release == NULL && array.release == NULL);
+                        assert(Arrow_exportResultSet(rset, 100, &schema, &array) == 0);
+                        // A SQLite column without a declared type can have values of different types
+                        if (Str_startsWith(testURL, "sqlite")) {
+                                rset = Connection_executeQuery(con, "select case when id < 3 then id when id < 5 then id + 0.5 else name end from zild_t order by id;");
+                                assert(Arrow_exportResultSet(rset, 100, &schema, &array) == 12);
+                                assert(Str_isEqual(schema.children[0]->format, "u"));
+                                offsets = array.children[0]->buffers[1];
+                                const char *text = array.children[0]->buffers[2];
+                                assert(offsets[1] == 1 && offsets[3] - offsets[2] == 3 && memcmp("1", text + offsets[0], 1) == 0 && memcmp("3.5", text + offsets[2], 3) == 0);
+                                assert(offsets[5] - offsets[4] == 8 && memcmp("Zoidberg", text + offsets[4], 8) == 0);
+                                schema.release(&schema);
+                                array.release(&array);
+                        }
+                }
+                printf("success\n");
+                printf("\tResult: check blob stream..");
+                {
+                        char data[8192];
+                        memset(data, 'y', sizeof(data));
+                        data[0] = 'S'; data[8191] = 'E';
+                        Stream_T stream = {data, sizeof(data), 0};
+                        pre = Connection_prepareStatement(con, "update zild_t set image=? where id=?;");
+                        PreparedStatement_setBlobStream(pre, 1, readStream, &stream);
+                        PreparedStatement_setInt(pre, 2, 11);
+                        PreparedStatement_execute(pre);
+                        rset = Connection_executeQuery(con, "select image from zild_t where id=11;");
+                        assert(ResultSet_next(rset));
+                        const char *image = ResultSet_getBlob(rset, 1, &imagesize);
+                        assert(imagesize == 8192 && image[0] == 'S' && image[1] == 'y' && image[8191] == 'E');
+                }
+                printf("success\n");
+                printf("\tResult: check blob read..");
+                {
+                        char chunk[1000];
+                        int n, offset = 0;
+                        rset = Connection_executeQuery(con, "select image from zild_t where id=11;");
+                        assert(ResultSet_next(rset));
+                        while ((n = ResultSet_readBlob(rset, 1, chunk, sizeof(chunk), offset)) > 0) {
+                                assert(chunk[0] == (offset ? 'y' : 'S'));
+                                offset += n;
+                        }
+                        assert(offset == 8192 && chunk[191] == 'E');
+                        assert(ResultSet_readBlob(rset, 1, chunk, sizeof(chunk), 8191) == 1 && chunk[0] == 'E');
+                }
+                printf("success\n");
                 printf("\tResult: check max rows..");
                 Connection_setMaxRows(con, 3);
                 rset = Connection_executeQuery(con, "select id from zild_t;");
@@ -249,6 +369,56 @@ static void testPool(const char *testURL) {
                 assert(ResultSet_next(names));
                 assert(Str_isEqual("Fry", ResultSet_getString(names, 1)));
                 printf("success\n");
+                printf("\tResult: check list parameters..");
+                {
+                        long long int ids[] = {1, 3, 5, 6, 9};
+                        const char *fry[] = {"Fry"};
+                        pre = Connection_prepareStatement(con, "select count(*), sum(id) from zild_t where id in (?) and name not in (?);");
+                        for (int n = 1; n <= 5; n++) {
+                                int sum = 0;
+                                for (int j = 0; j < n; j++)
+                                        sum += ids[j];
+                                PreparedStatement_setLLongArray(pre, 1, ids, n);
+                                PreparedStatement_setStringArray(pre, 2, fry, 1);
+                                names = PreparedStatement_executeQuery(pre);
+                                assert(ResultSet_next(names));
+                                // Fry has id 1
+                                assert(ResultSet_getInt(names, 1) == n - 1);
+                                assert(ResultSet_getInt(names, 2) == sum - 1);
+                        }
+                        TRY
+                        {
+                                PreparedStatement_setStringArray(pre, 2, fry, 0);
+                                assert(!"Should not come here");
+                        }
+                        CATCH(SQLException)
+                        {
+                        }
+                        END_TRY;
+                        PreparedStatement_setLLong(pre, 1, 3);
+                        names = PreparedStatement_executeQuery(pre);
+                        assert(ResultSet_next(names));
+                        assert(ResultSet_getInt(names, 1) == 1);
+                }
+                printf("success\n");
+                printf("\tResult: check named parameters..");
+                pre = Connection_prepareStatement(con, "select name from zild_t where id=:id or (id=:id and name=:name) or name=':name';");
+                PreparedStatement_setIntByName(pre, "id", 2);
+                PreparedStatement_setStringByName(pre, "name", "Fry");
+                names = PreparedStatement_executeQuery(pre);
+                assert(ResultSet_next(names));
+                assert(Str_isEqual("Leela", ResultSet_getString(names, 1)));
+                assert(! ResultSet_next(names));
+                TRY
+                {
+                        PreparedStatement_setIntByName(pre, "nonexistent", 1);
+                        assert(!"Should not come here");
+                }
+                CATCH(SQLException)
+                {
+                }
+                END_TRY;
+                printf("success\n");
                 printf("\tResult: check prepared statement without in-params..");
                 pre = Connection_prepareStatement(con, "select name from zild_t;");
                 assert(pre);
@@ -570,6 +740,92 @@ static void testPool(const char *testURL) {
         }
         printf("=> Test9: OK\n\n");
 
+        printf("=> Test10: Blob\n");
+        {
+                /* Check that SQLite incremental Blob I/O can write and read a value in chunks */
+                if (Str_startsWith(testURL, "sqlite")) {
+                        char chunk[1000], data[10000];
+                        url = URL_new(testURL);
+                        pool = ConnectionPool_new(url);
+                        assert(pool);
+                        ConnectionPool_start(pool);
+                        Connection_T con = ConnectionPool_getConnection(pool);
+                        assert(con);
+                        for (int i = 0; i < sizeof(data); i++)
+                                data[i] = i % 256;
+                        Connection_execute(con, "CREATE TABLE zild_t(id INTEGER PRIMARY KEY, image BLOB);");
+                        Connection_beginTransaction(con);
+                        Connection_execute(con, "insert into zild_t (image) values(zeroblob(%d));", (int)sizeof(data));
+                        Blob_T b = Connection_openBlob(con, "zild_t", "image", Connection_lastRowId(con), true);
+                        assert(Blob_getSize(b) == sizeof(data));
+                        for (int offset = 0; offset < sizeof(data); offset += sizeof(chunk))
+                                Blob_write(b, data + offset, sizeof(chunk), offset);
+                        TRY
+                        {
+                                Blob_write(b, data, sizeof(chunk), sizeof(data)); // Cannot grow the value
+                                printf("\tResult: Blob write past end of value succeeded\n");
+                                exit(1);
+                        }
+                        CATCH(SQLException)
+                        {
+                                printf("\tTesting: Blob write past end of value.. ok\n");
+                        }
+                        END_TRY;
+                        Connection_commit(con); // Closes the Blob
+                        TRY
+                        {
+                                Blob_write(b, data, sizeof(chunk), 0);
+                                printf("\tResult: Blob write after commit succeeded\n");
+                                exit(1);
+                        }
+                        CATCH(SQLException)
+                        {
+                                printf("\tTesting: Blob closed by commit.. ok\n");
+                        }
+                        END_TRY;
+                        Connection_beginTransaction(con);
+                        b = Connection_openBlob(con, "zild_t", "image", Connection_lastRowId(con), true);
+                        Blob_write(b, data + 1, sizeof(chunk), 0);
+                        Connection_rollback(con); // Closes the Blob, the handle stays valid
+                        TRY
+                        {
+                                Blob_write(b, data, sizeof(chunk), 0);
+                                printf("\tResult: Blob write after rollback succeeded\n");
+                                exit(1);
+                        }
+                        CATCH(SQLException)
+                        {
+                                printf("\tTesting: Blob closed by rollback.. ok\n");
+                        }
+                        END_TRY;
+                        b = Connection_openBlob(con, "zild_t", "image", Connection_lastRowId(con), false);
+                        int n, offset = 0;
+                        while ((n = Blob_read(b, chunk, sizeof(chunk) - 1, offset)) > 0) {
+                                assert(memcmp(chunk, data + offset, n) == 0);
+                                offset += n;
+                        }
+                        assert(offset == sizeof(data));
+                        Blob_close(b);
+                        TRY
+                        {
+                                Blob_read(b, chunk, sizeof(chunk), 0);
+                                printf("\tResult: read from closed Blob succeeded\n");
+                                exit(1);
+                        }
+                        CATCH(SQLException)
+                        {
+                                printf("\tTesting: read from closed Blob.. ok\n");
+                        }
+                        END_TRY;
+                        Connection_execute(con, "drop table zild_t;");
+                        Connection_close(con);
+                        ConnectionPool_stop(pool);
+                        ConnectionPool_free(&pool);
+                        URL_free(&url);
+                }
+        }
+        printf("=> Test10: OK\n\n");
+
         printf("============> Connection Pool Tests: OK\n\n");
 }
 
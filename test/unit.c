@@ -121,6 +121,32 @@ static void testStr() {
                 END_TRY;
         }
         printf("=> Test6: OK\n\n");
+
+        printf("=> Test7: decodeHex\n");
+        {
+                char d[STRLEN];
+                char s[STRLEN] = "48656C6c6f";
+                assert(Str_decodeHex(d, s, 10) == 5);
+                assert(memcmp(d, "Hello", 5) == 0);
+                printf("\tTesting whitespace between pairs\n");
+                assert(Str_decodeHex(d, " 48 65\n6c 6c\t6f ", 18) == 5);
+                assert(memcmp(d, "Hello", 5) == 0);
+                printf("\tTesting long string in place\n");
+                for (int i = 0; i < 200; i++)
+                        snprintf(s + i * 2, 3, "%02x", (i * 7) & 0xff);
+                assert(Str_decodeHex(s, s, 400 - 1) == 200);
+                for (int i = 0; i < 199; i++)
+                        assert((unsigned char)s[i] == ((i * 7) & 0xff));
+                assert((unsigned char)s[199] == (((199 * 7) & 0xff) & 0xf0));
+                printf("\tTesting long string with whitespace\n");
+                for (int i = 0; i < 50; i++)
+                        snprintf(s + i * 5, 6, "%02X%02X ", i, 255 - i);
+                assert(Str_decodeHex(d, s, 250) == 100);
+                for (int i = 0; i < 50; i++)
+                        assert((unsigned char)d[i * 2] == i && (unsigned char)d[i * 2 + 1] == 255 - i);
+                assert(Str_decodeHex(d, "", 0) == 0);
+        }
+        printf("=> Test7: OK\n\n");
         
         
         printf("============> Str Tests: OK\n\n");
@@ -582,6 +608,21 @@ static void testVector() {
 }
 
 
+static void appendName(int parameterIndex, const char *name, int length, void *ap) {
+        StringBuffer_append(ap, "%d:%.*s ", parameterIndex, length, name);
+}
+
+
+static void appendNative(const char *name, int length, void *ap) {
+        StringBuffer_append(ap, "%.*s ", name ? length : 1, name ? name : "?");
+}
+
+
+static void appendList(int parameterIndex, void *ap) {
+        StringBuffer_append(ap, "%d ", parameterIndex);
+}
+
+
 static void testStringBuffer() {
         StringBuffer_T sb;
         printf("============> Start StringBuffer Tests\n\n");
@@ -694,9 +735,26 @@ static void testStringBuffer() {
                 assert(Str_isEqual(StringBuffer_toString(sb), "insert into host values($1, $2, $3, $4, $5, $6, $7, $8, $9, $10, $11, $12);"));
                 StringBuffer_free(&sb);
                 assert(sb == NULL);
-                // Replace n > 99, should throw exception
-                sb = StringBuffer_new("insert into host values(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);");
-                assert(sb);
+                // Replace n > 99
+                sb = StringBuffer_create(1024);
+                for (int i = 0; i < 1000; i++)
+                        StringBuffer_append(sb, "?,");
+                assert(StringBuffer_prepare4postgres(sb) == 1000);
+                assert(Str_startsWith(StringBuffer_toString(sb), "$1,$2,$3,"));
+                assert(strstr(StringBuffer_toString(sb), ",$99,$100,$101,"));
+                assert(Str_isEqual(StringBuffer_toString(sb) + StringBuffer_length(sb) - 12, ",$999,$1000,"));
+                StringBuffer_free(&sb);
+                assert(sb == NULL);
+                // ? in literals and comments are not parameters
+                sb = StringBuffer_new("select '?', \"?\", 'it''s?', $$?$$, $1 -- ?\nfrom t /* ? */ where a=? and b=?");
+                assert(StringBuffer_prepare4oracle(sb) == 2);
+                assert(Str_isEqual(StringBuffer_toString(sb), "select '?', \"?\", 'it''s?', $$?$$, $1 -- ?\nfrom t /* ? */ where a=:1 and b=:2"));
+                StringBuffer_free(&sb);
+                assert(sb == NULL);
+                // Replace n > 65535, should throw exception
+                sb = StringBuffer_create(65536);
+                for (int i = 0; i < 65536; i++)
+                        StringBuffer_append(sb, "?");
                 TRY
                 {
                         StringBuffer_prepare4postgres(sb);
@@ -704,10 +762,28 @@ static void testStringBuffer() {
                 }
                 CATCH(SQLException)
                 {
+                        assert(StringBuffer_length(sb) == 65536);
                         StringBuffer_free(&sb);
                         assert(sb == NULL);
                 }
                 END_TRY;
+                // Far more ?'s than allowed, should throw before an index overflows the buffer
+                char *marks = ALLOC(10000001);
+                memset(marks, '?', 10000000);
+                marks[10000000] = 0;
+                sb = StringBuffer_new(marks);
+                FREE(marks);
+                TRY
+                {
+                        StringBuffer_prepare4postgres(sb);
+                        assert(!"Should not come here");
+                }
+                CATCH(SQLException)
+                {
+                        assert(StringBuffer_length(sb) == 10000000);
+                        StringBuffer_free(&sb);
+                }
+                END_TRY;
                 // Just 99 ?'s
                 sb = StringBuffer_new("???????????????????????????????????????????????????????????????????????????????????????????????????");
                 assert(StringBuffer_prepare4postgres(sb) == 99);
@@ -751,6 +827,106 @@ static void testStringBuffer() {
                 assert(sb == NULL);
         }
         printf("=> Test7: OK\n\n");
+
+        printf("=> Test8: prepareNamed\n");
+        {
+                StringBuffer_T names = StringBuffer_create(64);
+                // Nothing to replace
+                sb = StringBuffer_new("select a::text, b[1:2] from host where c=:1;");
+                assert(StringBuffer_prepareNamed(sb, appendName, names) == 0);
+                assert(Str_isEqual(StringBuffer_toString(sb), "select a::text, b[1:2] from host where c=:1;"));
+                assert(StringBuffer_length(names) == 0);
+                StringBuffer_free(&sb);
+                // Repeated names
+                sb = StringBuffer_new("update host set name=:name, id=:id_2 where id=:id_2 or name=:name;");
+                assert(StringBuffer_prepareNamed(sb, appendName, names) == 4);
+                assert(Str_isEqual(StringBuffer_toString(sb), "update host set name=?, id=? where id=? or name=?;"));
+                assert(Str_isEqual(StringBuffer_toString(names), "1:name 2:id_2 3:id_2 4:name "));
+                StringBuffer_free(&sb);
+                // Names in literals and comments are kept
+                StringBuffer_clear(names);
+                sb = StringBuffer_new("select ':a', \":b\", `:c`, 'it''s :d', E'e\\':e', $$:f$$, $x$:g$x$ -- :h\nfrom t where a=:a /* :i */ and b[lo:hi]=:b");
+                assert(StringBuffer_prepareNamed(sb, appendName, names) == 2);
+                assert(Str_isEqual(StringBuffer_toString(sb), "select ':a', \":b\", `:c`, 'it''s :d', E'e\\':e', $$:f$$, $x$:g$x$ -- :h\nfrom t where a=? /* :i */ and b[lo:hi]=?"));
+                assert(Str_isEqual(StringBuffer_toString(names), "1:a 2:b "));
+                StringBuffer_free(&sb);
+                // A backslash is only an escape in E'..' strings or if escapes are set
+                StringBuffer_clear(names);
+                sb = StringBuffer_new("select 'C:\\', :a, e'\\' :b'");
+                assert(StringBuffer_prepareNamed(sb, appendName, names) == 1);
+                assert(Str_isEqual(StringBuffer_toString(sb), "select 'C:\\', ?, e'\\' :b'"));
+                assert(Str_isEqual(StringBuffer_toString(names), "1:a "));
+                StringBuffer_free(&sb);
+                StringBuffer_clear(names);
+                sb = StringBuffer_setEscapes(StringBuffer_new("select 'it\\'s :a', \"\\\" :b\", :c"), true);
+                assert(StringBuffer_prepareNamed(sb, appendName, names) == 1);
+                assert(Str_isEqual(StringBuffer_toString(sb), "select 'it\\'s :a', \"\\\" :b\", ?"));
+                assert(Str_isEqual(StringBuffer_toString(names), "1:c "));
+                StringBuffer_free(&sb);
+                // Named and ? parameters cannot be mixed, should throw exception
+                StringBuffer_clear(names);
+                sb = StringBuffer_new("select a from b where a=? and b=:b");
+                TRY
+                {
+                        StringBuffer_prepareNamed(sb, appendName, names);
+                        assert(!"Should not come here");
+                }
+                CATCH(SQLException)
+                {
+                        StringBuffer_free(&sb);
+                }
+                END_TRY;
+                sb = StringBuffer_new("select a from b where a=:a and b=? and c='?'");
+                TRY
+                {
+                        StringBuffer_prepareNamed(sb, appendName, names);
+                        assert(!"Should not come here");
+                }
+                CATCH(SQLException)
+                {
+                        StringBuffer_free(&sb);
+                }
+                END_TRY;
+                assert(sb == NULL);
+                // Find named and ? parameters without rewriting
+                StringBuffer_clear(names);
+                sb = StringBuffer_new("select a::text, ':b' from t where a=:a and b=? and c=:a -- :d");
+                assert(StringBuffer_mapNamed(sb, appendNative, names) == 2);
+                assert(Str_isEqual(StringBuffer_toString(sb), "select a::text, ':b' from t where a=:a and b=? and c=:a -- :d"));
+                assert(Str_isEqual(StringBuffer_toString(names), "a ? a "));
+                StringBuffer_free(&sb);
+                StringBuffer_free(&names);
+        }
+        printf("=> Test8: OK\n\n");
+
+        printf("=> Test9: list parameters\n");
+        {
+                StringBuffer_T lists = StringBuffer_create(64);
+                // Nothing to find
+                sb = StringBuffer_new("select a from b where c in (?, ?) and d=(?) and e in ('?') and f in (select ?);");
+                assert(StringBuffer_mapLists(sb, appendList, lists) == 0);
+                assert(StringBuffer_prepareAny(sb) == 0);
+                assert(Str_isEqual(StringBuffer_toString(sb), "select a from b where c in (?, ?) and d=(?) and e in ('?') and f in (select ?);"));
+                StringBuffer_free(&sb);
+                // Find list parameters
+                sb = StringBuffer_new("select a from b where c=? and d IN (?) and e not in( ? ) and f in (?);");
+                assert(StringBuffer_mapLists(sb, appendList, lists) == 3);
+                assert(Str_isEqual(StringBuffer_toString(lists), "2 3 4 "));
+                assert(Str_isEqual(StringBuffer_toString(sb), "select a from b where c=? and d IN (?) and e not in( ? ) and f in (?);"));
+                // Expand
+                assert(StringBuffer_expandLists(sb, (int[]){2, 1, 4}) == 3);
+                assert(Str_isEqual(StringBuffer_toString(sb), "select a from b where c=? and d IN (?, ?) and e not in( ? ) and f in (?, ?, ?, ?);"));
+                StringBuffer_free(&sb);
+                // Rewrite for Postgres
+                sb = StringBuffer_new("select a from b where c=? and d IN (?) and e not in( ? );");
+                assert(StringBuffer_prepareAny(sb) == 2);
+                assert(Str_isEqual(StringBuffer_toString(sb), "select a from b where c=? and d = ANY(?) and e <> ALL(? );"));
+                assert(StringBuffer_prepare4postgres(sb) == 3);
+                assert(Str_isEqual(StringBuffer_toString(sb), "select a from b where c=$1 and d = ANY($2) and e <> ALL($3 );"));
+                StringBuffer_free(&sb);
+                StringBuffer_free(&lists);
+        }
+        printf("=> Test9: OK\n\n");
         
 
         printf("============> StringBuffer Tests: OK\n\n");